@@ -49,7 +49,7 @@ void usart2_isr(void)
 	if (((USART_CR1(USART2) & USART_CR1_TXEIE) != 0) &&
 	    ((USART_SR(USART2) & USART_SR_TXE) != 0)) {
 
-		if (fifo_read(&tx_fifo, &c, 1) == 1) {
+		if (fifo_pop1(&tx_fifo, &c)) {
 			tx_pending = true;
 			usart_send(USART2, c);
 		} else {
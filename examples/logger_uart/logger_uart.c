@@ -31,38 +31,38 @@
 
 #include "logger_uart.h"
 #include <mcu-common/logger.h>
-#include <mcu-common/critical.h>
+#include <mcu-common/dma_tx.h>
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/dma.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/usart.h>
 
 struct logger logger_uart;
 
-static struct fifo tx_fifo;
-static volatile bool tx_pending;
+static struct dma_tx uart_tx;
 
-void usart2_isr(void)
+/* USART2_TX is mapped to DMA1 stream 6, channel 4 */
+void dma1_stream6_isr(void)
 {
-	char c;
-
-	if (((USART_CR1(USART2) & USART_CR1_TXEIE) != 0) &&
-	    ((USART_SR(USART2) & USART_SR_TXE) != 0)) {
-
-		if (fifo_read(&tx_fifo, &c, 1) == 1) {
-			tx_pending = true;
-			usart_send(USART2, c);
-		} else {
-			usart_disable_tx_interrupt(USART2);
-			tx_pending = false;
-		}
+	if (dma_get_interrupt_flag(DMA1, DMA_STREAM6, DMA_TCIF)) {
+		dma_clear_interrupt_flags(DMA1, DMA_STREAM6, DMA_TCIF);
+		dma_tx_complete(&uart_tx);
 	}
 }
 
+static void uart_dma_start(const void *data, size_t length)
+{
+	dma_set_memory_address(DMA1, DMA_STREAM6, (uint32_t)data);
+	dma_set_number_of_data(DMA1, DMA_STREAM6, length);
+	dma_enable_stream(DMA1, DMA_STREAM6);
+}
+
 static void uart_init(void)
 {
 	rcc_periph_clock_enable(RCC_GPIOA);
 	rcc_periph_clock_enable(RCC_USART2);
+	rcc_periph_clock_enable(RCC_DMA1);
 
 	/* USART2_TX: */
 	gpio_mode_setup(GPIOA, GPIO_MODE_AF, GPIO_PUPD_NONE, GPIO2);
@@ -79,8 +79,21 @@ static void uart_init(void)
 	usart_set_parity(USART2, USART_PARITY_NONE);
 	usart_set_flow_control(USART2, USART_FLOWCONTROL_NONE);
 
-	/* TODO: Set NVIC_USART2_IRQ to the lowest priority */
-	nvic_enable_irq(NVIC_USART2_IRQ);
+	/* Memory to USART2_DR transfers: */
+	dma_stream_reset(DMA1, DMA_STREAM6);
+	dma_channel_select(DMA1, DMA_STREAM6, DMA_SxCR_CHSEL_4);
+	dma_set_transfer_mode(DMA1, DMA_STREAM6,
+			      DMA_SxCR_DIR_MEM_TO_PERIPHERAL);
+	dma_set_peripheral_address(DMA1, DMA_STREAM6, (uint32_t)&USART2_DR);
+	dma_set_peripheral_size(DMA1, DMA_STREAM6, DMA_SxCR_PSIZE_8BIT);
+	dma_set_memory_size(DMA1, DMA_STREAM6, DMA_SxCR_MSIZE_8BIT);
+	dma_enable_memory_increment_mode(DMA1, DMA_STREAM6);
+	dma_set_priority(DMA1, DMA_STREAM6, DMA_SxCR_PL_LOW);
+	dma_enable_transfer_complete_interrupt(DMA1, DMA_STREAM6);
+	usart_enable_tx_dma(USART2);
+
+	/* TODO: Set NVIC_DMA1_STREAM6_IRQ to the lowest priority */
+	nvic_enable_irq(NVIC_DMA1_STREAM6_IRQ);
 	usart_enable(USART2);
 }
 
@@ -89,24 +102,20 @@ static void uart_write(const char *str, size_t length)
 	if (!str || !length)
 		return;
 
-	CRITICAL_ENTER();
-
-	if (tx_pending) {
-		fifo_write(&tx_fifo, str, length);
-	} else {
-		if (length > 1)
-			fifo_write(&tx_fifo, &str[1], length-1);
-		tx_pending = true;
-		usart_send(USART2, str[0]);
-		usart_enable_tx_interrupt(USART2);
-	}
-
-	CRITICAL_EXIT();
+	dma_tx_write(&uart_tx, str, length);
 }
 
 void logger_uart_init(void)
 {
 	uart_init();
-	FIFO_INIT(&tx_fifo, sizeof(char), 1024);
-	LOGGER_INIT(&logger_uart, &uart_write, 64, 128);
+	DMA_TX_INIT(&uart_tx, &uart_dma_start, 1024);
+	/* The DMA stream counter (NDTR) is 16 bits wide: */
+	uart_tx.max_transfer = UINT16_MAX;
+#if LOGGER_BINARY
+	LOGGER_INIT(&logger_uart, &uart_write, 64, LOGGER_FRAME_SIZE);
+#else
+	/* Stream the messages straight to the DMA transmit buffer (no string
+	 buffer needed): */
+	LOGGER_INIT_STREAM(&logger_uart, &uart_write, 64);
+#endif
 }
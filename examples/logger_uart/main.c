@@ -31,6 +31,7 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <libopencm3/cm3/dwt.h>
 #include <libopencm3/cm3/nvic.h>
 #include <libopencm3/cm3/systick.h>
 #include <libopencm3/stm32/rcc.h>
@@ -76,6 +77,11 @@ int main(void)
 
 	/* Initialize and test the logger module: */
 	logger_uart_init();
+
+	/* Timestamp log entries using the DWT cycle counter: */
+	dwt_enable_cycle_counter();
+	logger_uart.clock_cb = &dwt_read_cycle_counter;
+
 	LOG("Hello World!\n");
 	LOG("Buld date: %s (%s)\n", __DATE__, __TIME__);
 	LOG("Six args: [ %d, %d, %d, %d, %d, %d ]\n", 10, 20, 30, 40, 50, 60);
@@ -84,7 +90,10 @@ int main(void)
 	unsigned int i = 0;
 
 	while (1) {
-		logger_process(&logger_uart);
+		/* Write pending messages to the UART (the streamed messages
+		 are gathered into chunks, so that each dma_tx_write() call
+		 copies more than a few bytes): */
+		logger_process_batch(&logger_uart, 16, 0);
 
 		if (loops < 500000) {
 			loops++;
@@ -37,12 +37,7 @@
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/gpio.h>
 #include "uart.h"
-#include "test_fifo.h"
-
-static bool run_tests(void)
-{
-	return test_fifo();
-}
+#include "tests.h"
 
 void __assert_func(const char *file, int line, const char *func,
 		   const char *failedexpr)
@@ -70,7 +65,7 @@ int main(void)
 	uart_printf("mcu-common: tests\n");
 	uart_printf("Build date: %s (%s)\n", __DATE__, __TIME__);
 
-	run_tests();
+	tests_run();
 	uart_printf("Done.\n");
 
 	while (1);
@@ -0,0 +1,145 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#include "test_dma_tx.h"
+#include "test.h"
+#include <string.h>
+#include <mcu-common/dma_tx.h>
+
+/* Mock of a DMA controller transferring data to an output buffer */
+static struct {
+	const char *data;
+	size_t length;
+	size_t starts;
+	char output[64];
+	size_t output_len;
+} dma;
+
+static void dma_start(const void *data, size_t length)
+{
+	dma.data = data;
+	dma.length = length;
+	dma.starts++;
+}
+
+/* Finishes the transfer in progress and calls the "interrupt handler" */
+static bool dma_finish(struct dma_tx *tx)
+{
+	if (dma.length == 0)
+		return false;
+
+	memcpy(&dma.output[dma.output_len], dma.data, dma.length);
+	dma.output_len += dma.length;
+	dma.output[dma.output_len] = '\0';
+	dma.length = 0;
+
+	dma_tx_complete(tx);
+
+	return true;
+}
+
+static void dma_reset(void)
+{
+	memset(&dma, 0, sizeof(dma));
+}
+
+static bool test_dma_tx_write(void)
+{
+	static struct dma_tx tx;
+	DMA_TX_INIT(&tx, &dma_start, 8);
+	dma_reset();
+
+	TEST_ASSERT(!dma_tx_busy(&tx));
+
+	/* The first write starts a transfer immediately: */
+	TEST_ASSERT(dma_tx_write(&tx, "abc", 3) == 3);
+	TEST_ASSERT(dma_tx_busy(&tx));
+	TEST_ASSERT(dma.starts == 1 && dma.length == 3);
+
+	/* Data written during a transfer wait for its completion: */
+	TEST_ASSERT(dma_tx_write(&tx, "def", 3) == 3);
+	TEST_ASSERT(dma.starts == 1);
+
+	/* The transferred data are not freed before the transfer completes: */
+	TEST_ASSERT(fifo_writable(tx.fifo) == 2);
+	TEST_ASSERT(dma_tx_write(&tx, "ghijk", 5) == 2);
+
+	TEST_ASSERT(dma_finish(&tx));
+	TEST_ASSERT(dma.starts == 2 && dma.length == 5);
+	TEST_ASSERT(fifo_writable(tx.fifo) == 3);
+
+	TEST_ASSERT(dma_finish(&tx));
+	TEST_ASSERT(!dma_tx_busy(&tx));
+	TEST_ASSERT(!dma_finish(&tx));
+
+	TEST_ASSERT(strcmp(dma.output, "abcdefgh") == 0);
+
+	return true;
+}
+
+static bool test_dma_tx_wrap(void)
+{
+	static struct dma_tx tx;
+	DMA_TX_INIT(&tx, &dma_start, 8);
+	dma_reset();
+
+	TEST_ASSERT(dma_tx_write(&tx, "012345", 6) == 6);
+	TEST_ASSERT(dma_finish(&tx));
+
+	/* Data wrapping around the end of the buffer need two transfers: */
+	TEST_ASSERT(dma_tx_write(&tx, "6789ab", 6) == 6);
+	TEST_ASSERT(dma.length == 3);
+	TEST_ASSERT(dma_finish(&tx));
+	TEST_ASSERT(dma.length == 3);
+	TEST_ASSERT(dma_finish(&tx));
+	TEST_ASSERT(dma.starts == 3);
+
+	/* Transfers are limited by max_transfer: */
+	tx.max_transfer = 2;
+	TEST_ASSERT(dma_tx_write(&tx, "cdef", 4) == 4);
+	while (dma_finish(&tx));
+	TEST_ASSERT(dma.starts == 5);
+
+	TEST_ASSERT(strcmp(dma.output, "0123456789abcdef") == 0);
+
+	return true;
+}
+
+bool test_dma_tx(void)
+{
+	bool status = true;
+
+	status &= TEST_RUN(test_dma_tx_write);
+	status &= TEST_RUN(test_dma_tx_wrap);
+
+	return status;
+}
@@ -31,6 +31,7 @@
 
 #include "test_fifo.h"
 #include "test.h"
+#include "cycles.h"
 #include <stdint.h>
 #include <string.h>
 #include <mcu-common/fifo.h>
@@ -121,6 +122,57 @@ static bool test_fifo_operations(void)
 	return true;
 }
 
+static bool test_fifo_reserve(void)
+{
+	struct fifo fifo;
+	int *ptr;
+
+	FIFO_INIT(&fifo, sizeof(int), 5);
+
+	TEST_ASSERT(fifo_acquire(&fifo, (void **)&ptr) == 0);
+	TEST_ASSERT(fifo_reserve(&fifo, (void **)&ptr) == 5);
+	for (int i = 0; i < 5; i++)
+		ptr[i] = i+1;
+
+	TEST_ASSERT(fifo_readable(&fifo) == 0); /* Not committed yet */
+	fifo_commit(&fifo, 5); /* fifo: { 1, 2, 3, 4, 5 } */
+	TEST_ASSERT(fifo_readable(&fifo) == 5);
+	TEST_ASSERT(fifo_reserve(&fifo, (void **)&ptr) == 0);
+
+	TEST_ASSERT(fifo_acquire(&fifo, (void **)&ptr) == 5);
+	TEST_ASSERT(ptr[0] == 1);
+	TEST_ASSERT(ptr[2] == 3);
+	fifo_release(&fifo, 3); /* fifo: { 4, 5 } */
+	TEST_ASSERT(fifo_writable(&fifo) == 3);
+
+	/* The free space wraps, only a part of it is contiguous: */
+	TEST_ASSERT(fifo_reserve(&fifo, (void **)&ptr) == 1);
+	ptr[0] = 6;
+	fifo_commit(&fifo, 1); /* fifo: { 4, 5, 6 } */
+	TEST_ASSERT(fifo_reserve(&fifo, (void **)&ptr) == 2);
+	ptr[0] = 7;
+	ptr[1] = 8;
+	fifo_commit(&fifo, 2); /* fifo: { 4, 5, 6, 7, 8 } */
+	TEST_ASSERT(fifo_writable(&fifo) == 0);
+
+	/* The data wraps, it is read in two parts: */
+	TEST_ASSERT(fifo_acquire(&fifo, (void **)&ptr) == 3);
+	TEST_ASSERT(ptr[0] == 4);
+	TEST_ASSERT(ptr[1] == 5);
+	TEST_ASSERT(ptr[2] == 6);
+	fifo_release(&fifo, 3);
+
+	TEST_ASSERT(fifo_acquire(&fifo, (void **)&ptr) == 2);
+	TEST_ASSERT(ptr[0] == 7);
+	TEST_ASSERT(ptr[1] == 8);
+	fifo_release(&fifo, 2);
+
+	TEST_ASSERT(fifo_readable(&fifo) == 0);
+	TEST_ASSERT(fifo_writable(&fifo) == 5);
+
+	return true;
+}
+
 static bool test_fifo_str(void)
 {
 	static const char *lines[] = {
@@ -176,6 +228,286 @@ static bool test_fifo_str(void)
 	return true;
 }
 
+static bool test_fifo_ngets(void)
+{
+	struct fifo fifo;
+	FIFO_INIT(&fifo, sizeof(char), 16);
+
+	char str[8];
+
+	/* Wrap around the end of the buffer: */
+	TEST_ASSERT(fifo_puts(&fifo, "0123456789") == 10);
+	TEST_ASSERT(fifo_ngets(&fifo, str, sizeof(str)) == 7);
+	TEST_ASSERT(strcmp(str, "0123456") == 0);
+	TEST_ASSERT(fifo_ngets(&fifo, str, sizeof(str)) == 3);
+	TEST_ASSERT(strcmp(str, "789") == 0);
+	TEST_ASSERT(fifo_readable(&fifo) == 0);
+
+	TEST_ASSERT(fifo_puts(&fifo, "abcdefg") == 7); /* Fits exactly */
+	TEST_ASSERT(fifo_puts(&fifo, "hi") == 2);
+	TEST_ASSERT(fifo_ngets(&fifo, str, sizeof(str)) == 7);
+	TEST_ASSERT(strcmp(str, "abcdefg") == 0);
+	TEST_ASSERT(fifo_readable(&fifo) == 3);
+	TEST_ASSERT(fifo_ngets(&fifo, str, 1) == 0);
+	TEST_ASSERT(fifo_ngets(&fifo, str, sizeof(str)) == 2);
+	TEST_ASSERT(strcmp(str, "hi") == 0);
+
+	/* Incomplete string: */
+	TEST_ASSERT(fifo_write(&fifo, "xyz", 3) == 3);
+	TEST_ASSERT(fifo_ngets(&fifo, str, sizeof(str)) == 3);
+	TEST_ASSERT(strcmp(str, "xyz") == 0);
+	TEST_ASSERT(fifo_ngets(&fifo, str, sizeof(str)) == 0);
+	TEST_ASSERT(str[0] == '\0');
+
+	return true;
+}
+
+static bool test_fifo_str_record(void)
+{
+	struct fifo fifo;
+	FIFO_INIT(&fifo, sizeof(char), 16);
+
+	char str[8];
+
+	TEST_ASSERT(fifo_read_str(&fifo, str, sizeof(str)) == -1);
+	TEST_ASSERT(str[0] == '\0');
+
+	for (int i = 0; i < 4; i++) { /* Wrap around the end of the buffer */
+		TEST_ASSERT(fifo_write_str(&fifo, "hello", 5));
+		TEST_ASSERT(fifo_write_str(&fifo, "", 0));
+		TEST_ASSERT(fifo_readable(&fifo) == 2+5 + 2);
+		TEST_ASSERT(!fifo_write_str(&fifo, "world!", 6));
+		TEST_ASSERT(fifo_readable(&fifo) == 2+5 + 2);
+
+		TEST_ASSERT(fifo_read_str(&fifo, str, sizeof(str)) == 5);
+		TEST_ASSERT(strcmp(str, "hello") == 0);
+		TEST_ASSERT(fifo_read_str(&fifo, str, sizeof(str)) == 0);
+		TEST_ASSERT(str[0] == '\0');
+		TEST_ASSERT(fifo_readable(&fifo) == 0);
+		TEST_ASSERT(fifo_read_str(&fifo, str, sizeof(str)) == -1);
+	}
+
+	/* Records are discarded if the size is 0: */
+	TEST_ASSERT(fifo_write_str(&fifo, "", 0));
+	TEST_ASSERT(fifo_write_str(&fifo, "abc", 3));
+	TEST_ASSERT(fifo_read_str(&fifo, NULL, 0) == 0);
+	TEST_ASSERT(fifo_read_str(&fifo, NULL, 0) == 3);
+	TEST_ASSERT(fifo_readable(&fifo) == 0);
+	TEST_ASSERT(fifo_read_str(&fifo, NULL, 0) == -1);
+
+	/* Truncated, the whole record is removed: */
+	TEST_ASSERT(fifo_write_str(&fifo, "0123456789", 10));
+	TEST_ASSERT(fifo_read_str(&fifo, str, sizeof(str)) == 10);
+	TEST_ASSERT(strcmp(str, "0123456") == 0);
+	TEST_ASSERT(fifo_readable(&fifo) == 0);
+
+	return true;
+}
+
+static bool test_fifo_peek(void)
+{
+	struct fifo fifo;
+	FIFO_INIT(&fifo, sizeof(char), 16);
+
+	char buf[16];
+	size_t pos;
+
+	TEST_ASSERT(fifo_peek(&fifo, 0, buf, sizeof(buf)) == 0);
+	TEST_ASSERT(!fifo_find(&fifo, 0, '$', &pos));
+	TEST_ASSERT(fifo_skip(&fifo, 1) == 0);
+
+	/* Move the read position so that the frames wrap around: */
+	TEST_ASSERT(fifo_write(&fifo, "0123456789", 10) == 10);
+	TEST_ASSERT(fifo_skip(&fifo, 10) == 10);
+
+	TEST_ASSERT(fifo_write(&fifo, "xx$ab*cd\n$e", 11) == 11);
+
+	TEST_ASSERT(fifo_find(&fifo, 0, '$', &pos));
+	TEST_ASSERT(pos == 2);
+	TEST_ASSERT(fifo_find(&fifo, 3, '$', &pos));
+	TEST_ASSERT(pos == 9);
+	TEST_ASSERT(fifo_find(&fifo, 9, '$', &pos));
+	TEST_ASSERT(pos == 9);
+	TEST_ASSERT(!fifo_find(&fifo, 10, '$', &pos));
+	TEST_ASSERT(!fifo_find(&fifo, 11, 'e', &pos));
+
+	TEST_ASSERT(fifo_skip(&fifo, 2) == 2);
+
+	/* Non-destructive: */
+	TEST_ASSERT(fifo_peek(&fifo, 1, buf, 4) == 4);
+	TEST_ASSERT(memcmp(buf, "ab*c", 4) == 0);
+	TEST_ASSERT(fifo_peek(&fifo, 6, buf, sizeof(buf)) == 3);
+	TEST_ASSERT(memcmp(buf, "\n$e", 3) == 0);
+	TEST_ASSERT(fifo_peek(&fifo, 9, buf, sizeof(buf)) == 0);
+	TEST_ASSERT(fifo_readable(&fifo) == 9);
+
+	TEST_ASSERT(fifo_read_until(&fifo, buf, 4, '\n') == 0);
+	TEST_ASSERT(fifo_read_until(&fifo, buf, sizeof(buf), '\n') == 7);
+	TEST_ASSERT(memcmp(buf, "$ab*cd\n", 7) == 0);
+	TEST_ASSERT(fifo_read_until(&fifo, buf, sizeof(buf), '\n') == 0);
+	TEST_ASSERT(fifo_readable(&fifo) == 2);
+
+	TEST_ASSERT(fifo_skip(&fifo, 5) == 2);
+	TEST_ASSERT(fifo_readable(&fifo) == 0);
+
+	return true;
+}
+
+static bool test_fifo_overwrite(void)
+{
+	struct fifo fifo;
+	FIFO_INIT(&fifo, sizeof(uint32_t), 4);
+
+	uint32_t buf[8];
+
+	TEST_ASSERT(fifo_snapshot(&fifo, buf, ARRAY_SIZE(buf)) == 0);
+
+	for (uint32_t i = 0; i < 6; i++)
+		TEST_ASSERT(fifo_write_overwrite(&fifo, &i, 1) == (i < 4 ? 0 : 1));
+
+	/* The snapshot does not remove the elements: */
+	for (int i = 0; i < 2; i++) {
+		TEST_ASSERT(fifo_snapshot(&fifo, buf, ARRAY_SIZE(buf)) == 4);
+		for (uint32_t j = 0; j < 4; j++)
+			TEST_ASSERT(buf[j] == 2 + j);
+	}
+
+	TEST_ASSERT(fifo_snapshot(&fifo, buf, 3) == 3);
+	for (uint32_t j = 0; j < 3; j++)
+		TEST_ASSERT(buf[j] == 3 + j);
+
+	/* More elements than the capacity: */
+	uint32_t data[7] = { 10, 11, 12, 13, 14, 15, 16 };
+	TEST_ASSERT(fifo_write_overwrite(&fifo, data, 7) == 3 + 4);
+	TEST_ASSERT(fifo_snapshot(&fifo, buf, ARRAY_SIZE(buf)) == 4);
+	TEST_ASSERT(memcmp(buf, &data[3], 4 * sizeof(uint32_t)) == 0);
+
+	TEST_ASSERT(fifo_write_overwrite(&fifo, data, 2) == 2);
+	TEST_ASSERT(fifo_snapshot(&fifo, buf, ARRAY_SIZE(buf)) == 4);
+	TEST_ASSERT(buf[0] == 15 && buf[1] == 16);
+	TEST_ASSERT(buf[2] == 10 && buf[3] == 11);
+
+	/* Producer of variable-length records: */
+	fifo_discard(&fifo, 3);
+	TEST_ASSERT(fifo_readable(&fifo) == 1);
+	TEST_ASSERT(fifo_snapshot(&fifo, buf, ARRAY_SIZE(buf)) == 1);
+	TEST_ASSERT(buf[0] == 11);
+
+	/* The elements are still readable in order: */
+	TEST_ASSERT(fifo_write_overwrite(&fifo, data, 4) == 1);
+	TEST_ASSERT(fifo_read(&fifo, buf, ARRAY_SIZE(buf)) == 4);
+	TEST_ASSERT(memcmp(buf, data, 4 * sizeof(uint32_t)) == 0);
+	TEST_ASSERT(fifo_snapshot(&fifo, buf, ARRAY_SIZE(buf)) == 0);
+
+	return true;
+}
+
+static bool test_fifo_single(void)
+{
+	struct fifo fifo;
+	FIFO_INIT(&fifo, sizeof(char), 10);
+
+	/* Interleave with fifo_write()/fifo_read() to cross the wrap point: */
+	for (int round = 0; round < 3; round++) {
+		for (char i = 0; i < (char)fifo_capacity(&fifo); i++) {
+			TEST_ASSERT(fifo_push1(&fifo, &i));
+		}
+
+		char val = 42;
+		TEST_ASSERT(!fifo_push1(&fifo, &val));
+		TEST_ASSERT(fifo_write(&fifo, &val, 1) == 0);
+
+		TEST_ASSERT(fifo_read(&fifo, &val, 1) == 1);
+		TEST_ASSERT(val == 0);
+
+		for (char i = 1; i < (char)fifo_capacity(&fifo); i++) {
+			TEST_ASSERT(fifo_pop1(&fifo, &val));
+			TEST_ASSERT(val == i);
+		}
+
+		TEST_ASSERT(!fifo_pop1(&fifo, &val));
+		TEST_ASSERT(fifo_readable(&fifo) == 0);
+
+		val = 7;
+		TEST_ASSERT(fifo_write(&fifo, &val, 1) == 1);
+		TEST_ASSERT(fifo_pop1(&fifo, &val));
+		TEST_ASSERT(val == 7);
+	}
+
+	struct fifo fifo64;
+	FIFO_INIT(&fifo64, sizeof(uint64_t), 5);
+
+	for (uint64_t i = 0; i < 12; i++) {
+		uint64_t val = 0x0102030405060708u * i;
+		TEST_ASSERT(fifo_push1(&fifo64, &val));
+		TEST_ASSERT(fifo_readable(&fifo64) == 1);
+		TEST_ASSERT(fifo_pop1(&fifo64, &val));
+		TEST_ASSERT(val == 0x0102030405060708u * i);
+	}
+
+	/* Elements larger than FIFO_INLINE_SIZE_MAX: */
+	struct fifo fifo_big;
+	FIFO_INIT(&fifo_big, 2*FIFO_INLINE_SIZE_MAX, 3);
+
+	char big[2*FIFO_INLINE_SIZE_MAX];
+	for (int i = 0; i < 3; i++) {
+		memset(big, 'a' + i, sizeof(big));
+		TEST_ASSERT(fifo_push1(&fifo_big, big));
+	}
+	TEST_ASSERT(!fifo_push1(&fifo_big, big));
+
+	for (int i = 0; i < 3; i++) {
+		TEST_ASSERT(fifo_pop1(&fifo_big, big));
+		TEST_ASSERT(big[0] == 'a' + i);
+		TEST_ASSERT(big[sizeof(big)-1] == 'a' + i);
+	}
+	TEST_ASSERT(!fifo_pop1(&fifo_big, big));
+
+	return true;
+}
+
+#define CYCLES_ITERATIONS	64
+
+/* Average cycles per element of fifo_write/read() vs. fifo_push1/pop1(): */
+static bool test_fifo_single_cycles(void)
+{
+	struct fifo fifo;
+	FIFO_INIT(&fifo, sizeof(char), CYCLES_ITERATIONS);
+
+	cycles_init();
+
+	char val = 0;
+	uint32_t start = cycles_read();
+	for (int i = 0; i < CYCLES_ITERATIONS; i++)
+		fifo_write(&fifo, &val, 1);
+	uint32_t write = cycles_read() - start;
+
+	start = cycles_read();
+	for (int i = 0; i < CYCLES_ITERATIONS; i++)
+		fifo_read(&fifo, &val, 1);
+	uint32_t read = cycles_read() - start;
+
+	start = cycles_read();
+	for (int i = 0; i < CYCLES_ITERATIONS; i++)
+		fifo_push1(&fifo, &val);
+	uint32_t push1 = cycles_read() - start;
+
+	start = cycles_read();
+	for (int i = 0; i < CYCLES_ITERATIONS; i++)
+		fifo_pop1(&fifo, &val);
+	uint32_t pop1 = cycles_read() - start;
+
+	TEST_ASSERT(fifo_readable(&fifo) == 0);
+
+	TEST_PRINTF("cycles/element: write %u, read %u, push1 %u, pop1 %u\n",
+		    (unsigned)(write / CYCLES_ITERATIONS),
+		    (unsigned)(read / CYCLES_ITERATIONS),
+		    (unsigned)(push1 / CYCLES_ITERATIONS),
+		    (unsigned)(pop1 / CYCLES_ITERATIONS));
+
+	return true;
+}
+
 bool test_fifo(void)
 {
 	bool status = true;
@@ -183,7 +515,14 @@ bool test_fifo(void)
 	status &= TEST_RUN(test_fifo_char);
 	status &= TEST_RUN(test_fifo_uint64);
 	status &= TEST_RUN(test_fifo_operations);
+	status &= TEST_RUN(test_fifo_reserve);
 	status &= TEST_RUN(test_fifo_str);
+	status &= TEST_RUN(test_fifo_ngets);
+	status &= TEST_RUN(test_fifo_str_record);
+	status &= TEST_RUN(test_fifo_peek);
+	status &= TEST_RUN(test_fifo_overwrite);
+	status &= TEST_RUN(test_fifo_single);
+	status &= TEST_RUN(test_fifo_single_cycles);
 
 	return status;
 }
@@ -0,0 +1,136 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#include "test_fifo_pow2.h"
+#include "test.h"
+#include <stdint.h>
+#include <mcu-common/fifo_pow2.h>
+
+static bool test_fifo_pow2_char(void)
+{
+	struct fifo_pow2 fifo;
+	FIFO_POW2_INIT(&fifo, sizeof(char), 16);
+
+	TEST_ASSERT(fifo_pow2_capacity(&fifo) == 16);
+
+	for (char i = 0; i < (char)fifo_pow2_capacity(&fifo); i++) {
+		TEST_ASSERT(fifo_pow2_write(&fifo, &i, 1) == 1);
+	}
+
+	char val = 42;
+	TEST_ASSERT(fifo_pow2_write(&fifo, &val, 1) == 0);
+
+	for (char i = 0; i < (char)fifo_pow2_capacity(&fifo); i++) {
+		TEST_ASSERT(fifo_pow2_read(&fifo, &val, 1) == 1);
+		TEST_ASSERT(val == i);
+	}
+
+	TEST_ASSERT(fifo_pow2_read(&fifo, &val, 1) == 0);
+
+	return true;
+}
+
+static bool test_fifo_pow2_operations(void)
+{
+	static const int in[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	static int out[8];
+	struct fifo_pow2 fifo;
+
+	FIFO_POW2_INIT(&fifo, sizeof(int), 8);
+
+	TEST_ASSERT(fifo_pow2_readable(&fifo) == 0);
+	TEST_ASSERT(fifo_pow2_writable(&fifo) == 8);
+	TEST_ASSERT(fifo_pow2_write(&fifo, in, 8) == 8);
+
+	TEST_ASSERT(fifo_pow2_readable(&fifo) == 8);
+	TEST_ASSERT(fifo_pow2_writable(&fifo) == 0);
+	TEST_ASSERT(fifo_pow2_read(&fifo, out, 5) == 5); /* fifo: { 6, 7, 8 } */
+	TEST_ASSERT(out[0] == 1);
+	TEST_ASSERT(out[4] == 5);
+
+	TEST_ASSERT(fifo_pow2_readable(&fifo) == 3);
+	TEST_ASSERT(fifo_pow2_writable(&fifo) == 5);
+	TEST_ASSERT(fifo_pow2_write(&fifo, in, 8) == 5);
+	/* fifo: { 6, 7, 8, 1, 2, 3, 4, 5 } */
+
+	TEST_ASSERT(fifo_pow2_readable(&fifo) == 8);
+	TEST_ASSERT(fifo_pow2_read(&fifo, out, 8) == 8);
+	TEST_ASSERT(out[0] == 6);
+	TEST_ASSERT(out[2] == 8);
+	TEST_ASSERT(out[3] == 1);
+	TEST_ASSERT(out[7] == 5);
+
+	TEST_ASSERT(fifo_pow2_readable(&fifo) == 0);
+	TEST_ASSERT(fifo_pow2_writable(&fifo) == 8);
+	TEST_ASSERT(fifo_pow2_read(&fifo, out, 8) == 0);
+
+	return true;
+}
+
+static bool test_fifo_pow2_overflow(void)
+{
+	struct fifo_pow2 fifo;
+	uint32_t val;
+
+	FIFO_POW2_INIT(&fifo, sizeof(uint32_t), 4);
+
+	/* Let the free-running counters overflow: */
+	fifo.head = (size_t)-2;
+	fifo.tail = (size_t)-2;
+
+	for (uint32_t i = 0; i < 4; i++)
+		TEST_ASSERT(fifo_pow2_write(&fifo, &i, 1) == 1);
+
+	TEST_ASSERT(fifo_pow2_readable(&fifo) == 4);
+	TEST_ASSERT(fifo_pow2_writable(&fifo) == 0);
+
+	for (uint32_t i = 0; i < 4; i++) {
+		TEST_ASSERT(fifo_pow2_read(&fifo, &val, 1) == 1);
+		TEST_ASSERT(val == i);
+	}
+
+	TEST_ASSERT(fifo_pow2_readable(&fifo) == 0);
+	TEST_ASSERT(fifo_pow2_writable(&fifo) == 4);
+
+	return true;
+}
+
+bool test_fifo_pow2(void)
+{
+	bool status = true;
+
+	status &= TEST_RUN(test_fifo_pow2_char);
+	status &= TEST_RUN(test_fifo_pow2_operations);
+	status &= TEST_RUN(test_fifo_pow2_overflow);
+
+	return status;
+}
@@ -0,0 +1,132 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+
+#include "test_fifo_typed.h"
+#include "test.h"
+#include <stdint.h>
+#include <mcu-common/fifo_typed.h>
+
+struct point {
+	int16_t x;
+	int16_t y;
+};
+
+DECLARE_FIFO(char_fifo, char, 16);
+DECLARE_FIFO(u32_fifo, uint32_t, 4);
+DECLARE_FIFO(point_fifo, struct point, 8);
+
+static bool test_fifo_typed_char(void)
+{
+	static struct char_fifo fifo;
+	char_fifo_init(&fifo);
+
+	TEST_ASSERT(char_fifo_readable(&fifo) == 0);
+	TEST_ASSERT(char_fifo_writable(&fifo) == 16);
+
+	for (char i = 0; i < 16; i++)
+		TEST_ASSERT(char_fifo_push(&fifo, i));
+
+	TEST_ASSERT(!char_fifo_push(&fifo, 42));
+	TEST_ASSERT(char_fifo_readable(&fifo) == 16);
+	TEST_ASSERT(char_fifo_writable(&fifo) == 0);
+
+	char val;
+	for (char i = 0; i < 16; i++) {
+		TEST_ASSERT(char_fifo_pop(&fifo, &val));
+		TEST_ASSERT(val == i);
+	}
+
+	TEST_ASSERT(!char_fifo_pop(&fifo, &val));
+
+	return true;
+}
+
+static bool test_fifo_typed_struct(void)
+{
+	static struct point_fifo fifo;
+	struct point p;
+
+	point_fifo_init(&fifo);
+
+	/* Keep crossing the end of the buffer: */
+	for (int16_t i = 0; i < 20; i++) {
+		TEST_ASSERT(point_fifo_push(&fifo, (struct point){ i, -i }));
+		TEST_ASSERT(point_fifo_push(&fifo, (struct point){ i, i }));
+		TEST_ASSERT(point_fifo_pop(&fifo, &p));
+		TEST_ASSERT(point_fifo_pop(&fifo, &p));
+		TEST_ASSERT(p.x == i && p.y == i);
+	}
+
+	TEST_ASSERT(point_fifo_readable(&fifo) == 0);
+
+	return true;
+}
+
+static bool test_fifo_typed_overflow(void)
+{
+	static struct u32_fifo fifo;
+	uint32_t val;
+
+	u32_fifo_init(&fifo);
+
+	/* Let the free-running counters overflow: */
+	fifo.head = (size_t)-2;
+	fifo.tail = (size_t)-2;
+
+	for (uint32_t i = 0; i < 4; i++)
+		TEST_ASSERT(u32_fifo_push(&fifo, i));
+
+	TEST_ASSERT(u32_fifo_readable(&fifo) == 4);
+	TEST_ASSERT(u32_fifo_writable(&fifo) == 0);
+
+	for (uint32_t i = 0; i < 4; i++) {
+		TEST_ASSERT(u32_fifo_pop(&fifo, &val));
+		TEST_ASSERT(val == i);
+	}
+
+	TEST_ASSERT(u32_fifo_readable(&fifo) == 0);
+	TEST_ASSERT(u32_fifo_writable(&fifo) == 4);
+
+	return true;
+}
+
+bool test_fifo_typed(void)
+{
+	bool status = true;
+
+	status &= TEST_RUN(test_fifo_typed_char);
+	status &= TEST_RUN(test_fifo_typed_struct);
+	status &= TEST_RUN(test_fifo_typed_overflow);
+
+	return status;
+}
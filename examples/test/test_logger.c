@@ -0,0 +1,819 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#include "test_logger.h"
+#include "test.h"
+#include <limits.h>
+#include <string.h>
+#include <mcu-common/logger.h>
+
+/* Size of the string buffer of the loggers (binary frames need more) */
+#if LOGGER_BINARY
+#define STR_SIZE(size)	LOGGER_FRAME_SIZE
+#else
+#define STR_SIZE(size)	(size)
+#endif
+
+static char output[256];
+static size_t output_len;
+static size_t output_writes;
+
+static void output_append(const char *str, size_t length)
+{
+	if (output_len + length >= sizeof(output))
+		length = sizeof(output) - output_len - 1;
+
+	memcpy(&output[output_len], str, length);
+	output_len += length;
+	output[output_len] = '\0';
+}
+
+#if LOGGER_BINARY
+
+/* Decodes the COBS frame, returns the length of the payload */
+static size_t frame_decode(const uint8_t *f, size_t length, uint8_t *payload)
+{
+	size_t len = 0;
+
+	for (size_t i = 0; i < length && f[i] != 0;) {
+		uint8_t code = f[i++];
+
+		for (uint8_t j = 1; j < code && i < length; j++)
+			payload[len++] = f[i++];
+
+		if (code < 0xff && i < length && f[i] != 0)
+			payload[len++] = 0;
+	}
+
+	return len;
+}
+
+/*
+ * Renders the payload to the output like logger_process() would. Only integer
+ * arguments are supported, the format string is looked up by its address (it
+ * is a part of this program).
+ */
+static void payload_render(const uint8_t *p)
+{
+	int argc = p[0] & 0x1f;
+	size_t pos = 2;
+	const char *fmt;
+	char str[64];
+
+	memcpy(&fmt, &p[pos], sizeof(fmt));
+	pos += sizeof(fmt);
+
+	if (p[0] & 0x20) {
+		uint32_t timestamp;
+		memcpy(&timestamp, &p[pos], sizeof(timestamp));
+		pos += sizeof(timestamp);
+
+		snprintf(str, sizeof(str), LOGGER_TIMESTAMP_FMT, timestamp);
+		output_append(str, strlen(str));
+	}
+
+	pos += (size_t)(argc + 1) / 2;
+
+	unsigned int args[6] = {0};
+	for (int i = 0; i < argc && i < 6; i++) {
+		memcpy(&args[i], &p[pos], sizeof(args[i]));
+		pos += sizeof(args[i]);
+	}
+
+	snprintf(str, sizeof(str), fmt, args[0], args[1], args[2], args[3],
+		 args[4], args[5]);
+	output_append(str, strlen(str));
+}
+
+static void write_cb(const char *str, size_t length)
+{
+	output_writes++;
+
+	/* The buffer holds one or more zero-terminated frames: */
+	for (size_t i = 0; i < length;) {
+		uint8_t payload[LOGGER_PAYLOAD_SIZE];
+		size_t n = strlen(&str[i]);
+
+		frame_decode((const uint8_t *)&str[i], n, payload);
+		payload_render(payload);
+		i += n + 1;
+	}
+}
+
+#else
+
+static void write_cb(const char *str, size_t length)
+{
+	output_writes++;
+	output_append(str, length);
+}
+
+#endif
+
+static void output_clear(void)
+{
+	output_len = 0;
+	output_writes = 0;
+	output[0] = '\0';
+}
+
+static bool test_logger_fifo(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 4, STR_SIZE(32));
+	output_clear();
+
+	TEST_ASSERT(!logger_process(&log));
+
+	TEST_ASSERT(LOGGER_PUT(&log, "a\n"));
+	TEST_ASSERT(LOGGER_PUT(&log, "%d\n", 1));
+	TEST_ASSERT(LOGGER_PUT(&log, "%d,%d\n", 2, 3));
+	TEST_ASSERT(LOGGER_PUT(&log, "%d,%d,%d,%d,%d,%d\n", 4, 5, 6, 7, 8, 9));
+
+	while (logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "a\n1\n2,3\n4,5,6,7,8,9\n") == 0);
+
+	return true;
+}
+
+#if !LOGGER_BINARY
+
+static bool test_logger_types(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 8, 128);
+	output_clear();
+
+	TEST_ASSERT(LOGGER_PUT(&log, "%s,%c,%%,%p\n", "str", 'c',
+			       (void *)0x1234));
+	TEST_ASSERT(LOGGER_PUT(&log, "%lld,%llx,%ld,%zu\n", -1234567890123LL,
+			       0x123456789abULL, -5L, (size_t)7));
+	TEST_ASSERT(LOGGER_PUT(&log, "%*d|%-*d|\n", 4, 1, 3, 2));
+	TEST_ASSERT(LOGGER_PUT(&log, "%02hhx,%hhd,%hu,%hd\n", (char)0xab,
+			       (signed char)-56, (short)-2, (short)-3));
+
+	while (logger_process(&log));
+
+	char expected[128];
+	snprintf(expected, sizeof(expected), "str,c,%%,%p\n"
+		 "-1234567890123,123456789ab,-5,7\n"
+		 "   1|2  |\n"
+		 "ab,-56,65534,-3\n", (void *)0x1234);
+	TEST_ASSERT(strcmp(output, expected) == 0);
+
+#if !LOGGER_BUILTIN_FORMAT
+	/* Floating-point conversions: */
+	output_clear();
+	TEST_ASSERT(LOGGER_PUT(&log, "%5.1f|%-*.*f|\n", 2.25, 6, 2, 3.14159));
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(strcmp(output, "  2.2|3.14  |\n") == 0);
+#endif
+
+	return true;
+}
+
+static bool test_logger_typed(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 8, 128);
+	output_clear();
+
+	/* The arguments are rendered with their actual types (LOGGER_PUT()
+	 would warn about the mismatching conversions): */
+	TEST_ASSERT(logger_put_typed(&log, 3, LOGGER_ARG_LLONG |
+				     LOGGER_ARG_INT << 4 |
+				     LOGGER_ARG_UINT << 8,
+				     "%d,%x,%u\n", -12345678901LL, -1, 200u));
+	TEST_ASSERT(logger_put_typed(&log, 3, LOGGER_ARG_DOUBLE |
+				     LOGGER_ARG_STR << 4 |
+				     LOGGER_ARG_INT << 8,
+				     "%d,%s,%c\n", 2.5, "ok", 'c'));
+
+	/* The types tagged by LOGGER_PUT(): */
+	TEST_ASSERT(LOGGER_PUT(&log, "%" PRId64 ",%hhu\n", INT64_C(-1),
+			       (uint8_t)200));
+
+	/* The types derived from the format string: */
+	TEST_ASSERT(logger_put(&log, 2, "%hd,%lu\n", 5, 6UL));
+
+	/* The conversions without arguments are rendered as placeholders: */
+	TEST_ASSERT(logger_put_typed(&log, 1, LOGGER_ARG_INT,
+				     "%d,%*d,%s%%\n", 7));
+
+	/* So are the too long specifications: */
+	TEST_ASSERT(logger_put_typed(&log, 2, LOGGER_ARG_INT |
+				     LOGGER_ARG_INT << 4,
+				     "%-----------------------------------5d,"
+				     "%d\n", 1, 2));
+
+	while (logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "-12345678901,ffffffff,200\n"
+			   "2,ok,c\n-1,200\n5,6\n7,?,?%\n?,2\n") == 0);
+
+#if !LOGGER_BUILTIN_FORMAT
+	/* An integer rendered by a floating-point conversion: */
+	output_clear();
+	TEST_ASSERT(logger_put_typed(&log, 1, LOGGER_ARG_INT, "%.1f\n", 3));
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(strcmp(output, "3.0\n") == 0);
+#endif
+
+	return true;
+}
+
+/* Checks that the message is rendered the same way as by snprintf(): */
+#define TEST_FORMAT(log, ...) \
+	do { \
+		char expected[128]; \
+		output_clear(); \
+		TEST_ASSERT(LOGGER_PUT((log), __VA_ARGS__)); \
+		TEST_ASSERT(logger_process(log)); \
+		snprintf(expected, sizeof(expected), __VA_ARGS__); \
+		TEST_ASSERT(strcmp(output, expected) == 0); \
+	} while (0)
+
+static bool test_logger_format(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 2, 128);
+
+	/* Signed integers: */
+	TEST_FORMAT(&log, "%d|%i|%5d|%-5d|%05d|%+d|\n", 42, -42, 42, 42, -42,
+		    42);
+	TEST_FORMAT(&log, "% d|%.3d|%8.3d|%-+6d|%d|%.0d|\n", 42, 7, -7, 3,
+		    INT_MIN, 0);
+	TEST_FORMAT(&log, "%lld|%hd|%hhd|%ld|\n", LLONG_MIN, (short)-300,
+		    (signed char)-100, LONG_MAX);
+
+	/* Unsigned integers: */
+	TEST_FORMAT(&log, "%u|%o|%#o|%x|%X|%#x|\n", 4000000000u, 8u, 8u,
+		    0xbeefu, 0xbeefu, 255u);
+	TEST_FORMAT(&log, "%#X|%#x|%08x|%-8X|%.5o|%#.3o|\n", 255u, 0u, 0xabcu,
+		    0xabcu, 9u, 8u);
+	TEST_FORMAT(&log, "%llu|%llx|%hu|%hhx|\n", ULLONG_MAX, ULLONG_MAX,
+		    (unsigned short)65535, (unsigned char)0xff);
+
+	/* Characters, strings and pointers: */
+	TEST_FORMAT(&log, "%c|%3c|%-3c|%s|%8s|%-8s|\n", 'a', 'b', 'c', "str",
+		    "str", "str");
+	TEST_FORMAT(&log, "%.2s|%5.1s|%p|%-12p|\n", "str", "str",
+		    (void *)0x1234, (void *)0xabcd);
+
+	/* Width and precision passed by '*': */
+	TEST_FORMAT(&log, "%*d|%-*x|%.*d|\n", 6, 1, 6, 0xa, 4, 5);
+	TEST_FORMAT(&log, "%*d|%.*s|%-*u|\n", -4, 1, 2, "str", 5, 7u);
+	TEST_FORMAT(&log, "%0*d|%.*d|%*s|\n", 5, -3, -1, 9, 4, "ab");
+
+	return true;
+}
+
+static bool test_logger_max_argc(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 2, 128);
+	output_clear();
+
+#if (LOGGER_MAX_ARGC >= 16) && !LOGGER_BUILTIN_FORMAT
+	TEST_ASSERT(LOGGER_PUT(&log, "%d %d %d %d %d %d %d %d "
+			       "%.1f %.1f %.1f %.1f %.1f %.1f %.1f %.1f\n",
+			       1, 2, 3, 4, 5, 6, 7, 8,
+			       0.5, 1.5, 2.5, 3.5, 4.5, 5.5, 6.5, 7.5));
+	TEST_ASSERT(logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "1 2 3 4 5 6 7 8 "
+			   "0.5 1.5 2.5 3.5 4.5 5.5 6.5 7.5\n") == 0);
+#elif (LOGGER_MAX_ARGC >= 16)
+	/* The built-in formatter does not render floating-point conversions,
+	 the arguments are of the same size: */
+	TEST_ASSERT(LOGGER_PUT(&log, "%d %d %d %d %d %d %d %d "
+			       "%lld %lld %lld %lld %lld %lld %lld %lld\n",
+			       1, 2, 3, 4, 5, 6, 7, 8,
+			       0LL, 1LL, 2LL, 3LL, 4LL, 5LL, 6LL, 7LL));
+	TEST_ASSERT(logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "1 2 3 4 5 6 7 8 "
+			   "0 1 2 3 4 5 6 7\n") == 0);
+#elif !LOGGER_BUILTIN_FORMAT
+	TEST_ASSERT(LOGGER_PUT(&log, "%d %d %d %.1f %.1f %.1f\n",
+			       1, 2, 3, 0.5, 1.5, 2.5));
+	TEST_ASSERT(logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "1 2 3 0.5 1.5 2.5\n") == 0);
+#else
+	TEST_ASSERT(LOGGER_PUT(&log, "%d %d %d %lld %lld %lld\n",
+			       1, 2, 3, 0LL, 1LL, 2LL));
+	TEST_ASSERT(logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "1 2 3 0 1 2\n") == 0);
+#endif
+
+	return true;
+}
+
+#endif
+
+static bool test_logger_fifo_short(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 4, STR_SIZE(32));
+	output_clear();
+
+	/* Short entries take less space than LOGGER_MESSAGE_SIZE: */
+	size_t size = 2 + sizeof(const char *) + 1 + sizeof(unsigned int);
+	size_t count = LOGGER_FIFO_SIZE(4) / size;
+
+	for (size_t i = 0; i < count; i++)
+		TEST_ASSERT(LOGGER_PUT(&log, "%d", (int)i % 10));
+
+	TEST_ASSERT(!LOGGER_PUT(&log, "%d", 0));
+	TEST_ASSERT(count > 4);
+
+	/* The dropped message is reported first: */
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(strcmp(output, "1 messages dropped\n") == 0);
+	output_clear();
+
+	for (size_t i = 0; i < count; i++) {
+		TEST_ASSERT(logger_process(&log));
+		TEST_ASSERT(output[i] == (char)('0' + i % 10));
+	}
+
+	TEST_ASSERT(!logger_process(&log));
+	TEST_ASSERT(output_len == count);
+
+	return true;
+}
+
+static uint32_t clock_cb(void)
+{
+	static uint32_t time = 100;
+	return time++;
+}
+
+static bool test_logger_timestamp(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 4, STR_SIZE(32));
+	output_clear();
+
+	TEST_ASSERT(LOGGER_PUT(&log, "a\n"));
+	log.clock_cb = &clock_cb;
+	TEST_ASSERT(LOGGER_PUT(&log, "b\n"));
+	TEST_ASSERT(LOGGER_PUT(&log, "%d\n", 42));
+
+	while (logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "a\n[       100] b\n[       101] 42\n") == 0);
+
+	return true;
+}
+
+static int evaluated;
+
+static int arg(int val)
+{
+	evaluated++;
+	return val;
+}
+
+static bool test_logger_level(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 4, STR_SIZE(32));
+	output_clear();
+	evaluated = 0;
+
+	TEST_ASSERT(LOGGER_ERROR(&log, 0, "e%d", arg(0)));
+	TEST_ASSERT(LOGGER_TRACE(&log, 31, "t%d", arg(31)));
+
+	log.module_mask = (1 << 2);
+	TEST_ASSERT(!LOGGER_ERROR(&log, 0, "e%d", arg(0)));
+	TEST_ASSERT(LOGGER_INFO(&log, 2, "i%d", arg(2)));
+
+	/* Arguments of disabled messages are not evaluated: */
+	TEST_ASSERT(evaluated == 3);
+
+	while (logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "e0t31i2") == 0);
+
+	return true;
+}
+
+static bool test_logger_lockfree(void)
+{
+	static struct logger log;
+	LOGGER_INIT_LOCKFREE(&log, &write_cb, 4, STR_SIZE(32));
+	output_clear();
+
+	TEST_ASSERT(!logger_process(&log));
+
+	/* Fill the queue several times to test wrapping: */
+	for (int lap = 0; lap < 3; lap++) {
+		for (int i = 0; i < 4; i++)
+			TEST_ASSERT(LOGGER_PUT(&log, "%d", lap*4 + i));
+
+		TEST_ASSERT(!LOGGER_PUT(&log, "full"));
+
+		while (logger_process(&log));
+	}
+
+	TEST_ASSERT(strcmp(output, "1 messages dropped\n0123"
+				   "1 messages dropped\n4567"
+				   "1 messages dropped\n891011") == 0);
+
+	return true;
+}
+
+static bool test_logger_stats(void)
+{
+	static struct logger log;
+	LOGGER_INIT_LOCKFREE(&log, &write_cb, 4, STR_SIZE(32));
+	output_clear();
+
+	for (int i = 0; i < 7; i++)
+		LOGGER_PUT(&log, "%d", i);
+
+	TEST_ASSERT(log.stats->enqueued == 4);
+	TEST_ASSERT(log.stats->dropped == 3);
+	TEST_ASSERT(log.stats->high_water == 4);
+
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(LOGGER_PUT(&log, "%d", 7));
+
+	while (logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "3 messages dropped\n01237") == 0);
+	TEST_ASSERT(log.stats->processed == 5);
+	TEST_ASSERT(log.stats->high_water == 4);
+
+	return true;
+}
+
+static bool test_logger_overwrite(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 2, STR_SIZE(32));
+	log.overflow = LOGGER_OVERWRITE_OLDEST;
+	output_clear();
+
+	/* All entries have the same size: */
+	size_t size = 2 + sizeof(const char *) + 1 + sizeof(unsigned int);
+	size_t count = LOGGER_FIFO_SIZE(2) / size;
+
+	for (size_t i = 0; i < count + 2; i++)
+		TEST_ASSERT(LOGGER_PUT(&log, "%d", (int)i % 10));
+
+	TEST_ASSERT(log.stats->dropped == 2);
+
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(strcmp(output, "2 messages dropped\n") == 0);
+	output_clear();
+
+	/* The oldest two entries have been overwritten: */
+	for (size_t i = 2; i < count + 2; i++) {
+		TEST_ASSERT(logger_process(&log));
+		TEST_ASSERT(output[i - 2] == (char)('0' + i % 10));
+	}
+
+	TEST_ASSERT(!logger_process(&log));
+
+	return true;
+}
+
+static uint32_t time_now;
+
+static uint32_t time_cb(void)
+{
+	return time_now++;
+}
+
+static bool test_logger_block(void)
+{
+	static struct logger log;
+	LOGGER_INIT_LOCKFREE(&log, &write_cb, 2, STR_SIZE(32));
+	log.overflow = LOGGER_BLOCK;
+	log.clock_cb = &time_cb;
+	log.block_timeout = 10;
+	output_clear();
+
+	TEST_ASSERT(LOGGER_PUT(&log, "a"));
+	TEST_ASSERT(LOGGER_PUT(&log, "b"));
+
+	/* Nobody processes the entries, logger_put() times out: */
+	time_now = 0;
+	TEST_ASSERT(!LOGGER_PUT(&log, "c"));
+	TEST_ASSERT(time_now >= 10);
+	TEST_ASSERT(log.stats->dropped == 1);
+
+	return true;
+}
+
+#if !LOGGER_BINARY
+
+static bool test_logger_batch(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 8, 8);
+	output_clear();
+
+	TEST_ASSERT(logger_process_batch(&log, 8, 0) == 0);
+	TEST_ASSERT(output_writes == 0);
+
+	for (int i = 0; i < 6; i++)
+		TEST_ASSERT(LOGGER_PUT(&log, "%d,", i));
+
+	/* Entries are written at once: */
+	TEST_ASSERT(logger_process_batch(&log, 3, 0) == 3);
+	TEST_ASSERT(output_writes == 1);
+	TEST_ASSERT(strcmp(output, "0,1,2,") == 0);
+
+	/* The buffer (7 characters) is flushed when full: */
+	TEST_ASSERT(LOGGER_PUT(&log, "%d", 123456));
+	TEST_ASSERT(logger_process_batch(&log, 8, 0) == 4);
+	TEST_ASSERT(output_writes == 3);
+	TEST_ASSERT(strcmp(output, "0,1,2,3,4,5,123456") == 0);
+
+	return true;
+}
+
+#endif
+
+static unsigned int shard;
+
+static unsigned int shard_cb(void)
+{
+	return shard;
+}
+
+#if !LOGGER_BINARY
+
+static bool test_logger_stream(void)
+{
+	static const char line[] = "This line is longer than the string "
+				   "buffer of any other logger in the tests, "
+				   "it is streamed without truncation.";
+	static struct logger log;
+	LOGGER_INIT_STREAM(&log, &write_cb, 4);
+	log.clock_cb = &clock_cb;
+	output_clear();
+
+	TEST_ASSERT(log.str == NULL);
+	TEST_ASSERT(LOGGER_PUT(&log, "%s|%5d|%-3x|\n", line, 42, 0xa));
+	TEST_ASSERT(logger_process(&log));
+
+	/* Unless the string has been copied (and truncated): */
+	int len = LOGGER_STRING_COPY ? LOGGER_STRING_COPY-1 : (int)strlen(line);
+	char expected[256];
+	snprintf(expected, sizeof(expected),
+		 LOGGER_TIMESTAMP_FMT "%.*s|   42|a  |\n", clock_cb() - 1, len,
+		 line);
+	TEST_ASSERT(strcmp(output, expected) == 0);
+
+	/* The long string has been written as it is, the timestamp and the rest
+	 of the message separately (unless the string has been copied): */
+	TEST_ASSERT(output_writes == (LOGGER_STRING_COPY ? 1 : 3));
+
+	/* A NULL string is not dereferenced (passed through a volatile pointer
+	 so that the compiler does not warn): */
+	const char *volatile null_str = NULL;
+	log.clock_cb = NULL;
+	output_clear();
+	TEST_ASSERT(LOGGER_PUT(&log, "%s|", null_str));
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(strcmp(output, "(null)|") == 0);
+
+	/* Short chunks of the batched messages are gathered: */
+	output_clear();
+	for (int i = 0; i < 3; i++)
+		TEST_ASSERT(LOGGER_PUT(&log, "%d,%d|", i, 10*i));
+	TEST_ASSERT(logger_process_batch(&log, 4, 0) == 3);
+	TEST_ASSERT(strcmp(output, "0,0|1,10|2,20|") == 0);
+	TEST_ASSERT(output_writes == 1);
+
+	return true;
+}
+
+#endif
+
+static bool test_logger_sharded(void)
+{
+	static struct logger log;
+	LOGGER_INIT_SHARDED(&log, &write_cb, 3, 2, STR_SIZE(32));
+	log.shard_cb = &shard_cb;
+	output_clear();
+
+	TEST_ASSERT(!logger_process(&log));
+
+	/* Entries from all shards are processed in the logged order: */
+	shard = 0;
+	TEST_ASSERT(LOGGER_PUT(&log, "a"));
+	shard = 2;
+	TEST_ASSERT(LOGGER_PUT(&log, "b"));
+	shard = 1;
+	TEST_ASSERT(LOGGER_PUT(&log, "%d", 1));
+	shard = 0;
+	TEST_ASSERT(LOGGER_PUT(&log, "c"));
+	shard = 2;
+	TEST_ASSERT(LOGGER_PUT(&log, "d"));
+
+	while (logger_process(&log));
+
+	TEST_ASSERT(strcmp(output, "ab1cd") == 0);
+	output_clear();
+
+	/* A full shard does not affect the others: */
+	shard = 1;
+	while (LOGGER_PUT(&log, "x"));
+	shard = 0;
+	TEST_ASSERT(LOGGER_PUT(&log, "y"));
+
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(strcmp(output, "1 messages dropped\n") == 0);
+
+	while (logger_process(&log));
+
+	TEST_ASSERT(output[output_len-1] == 'y');
+	TEST_ASSERT(log.stats->dropped == 1);
+
+	return true;
+}
+
+static bool test_logger_snapshot(void)
+{
+	static char buffer[LOGGER_SNAPSHOT_SIZE(3, 2)];
+
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 2, STR_SIZE(32));
+	log.overflow = LOGGER_OVERWRITE_OLDEST;
+	output_clear();
+
+	size_t size = 2 + sizeof(const char *) + 1 + sizeof(unsigned int);
+	size_t count = LOGGER_FIFO_SIZE(2) / size;
+
+	for (size_t i = 0; i < count + 3; i++)
+		TEST_ASSERT(LOGGER_PUT(&log, "%d", (int)i % 10));
+
+	/* The most recent entries are written and kept in the buffer: */
+	TEST_ASSERT(logger_snapshot(&log, buffer, sizeof(buffer)) == count);
+	TEST_ASSERT(output_len == count);
+	for (size_t i = 3; i < count + 3; i++)
+		TEST_ASSERT(output[i - 3] == (char)('0' + i % 10));
+
+	output_clear();
+	TEST_ASSERT(logger_snapshot(&log, buffer, sizeof(buffer)) == count);
+	TEST_ASSERT(output_len == count);
+
+	output_clear();
+	TEST_ASSERT(logger_process(&log));
+	TEST_ASSERT(strcmp(output, "3 messages dropped\n") == 0);
+
+	/* Flight recorder shards, merged in the logged order: */
+	static struct logger sharded;
+	LOGGER_INIT_SHARDED(&sharded, &write_cb, 3, 2, STR_SIZE(32));
+	sharded.shard_cb = &shard_cb;
+	sharded.overflow = LOGGER_OVERWRITE_OLDEST;
+	output_clear();
+
+	shard = 1;
+	TEST_ASSERT(LOGGER_PUT(&sharded, "a"));
+	shard = 0;
+	for (int i = 0; i < 100; i++)
+		TEST_ASSERT(LOGGER_PUT(&sharded, "%c", 'A' + i % 26));
+	shard = 2;
+	TEST_ASSERT(LOGGER_PUT(&sharded, "b"));
+	shard = 0;
+	TEST_ASSERT(LOGGER_PUT(&sharded, "z"));
+
+	TEST_ASSERT(sharded.stats->dropped > 0);
+	TEST_ASSERT(logger_snapshot(&sharded, buffer, sizeof(buffer)) ==
+		    103 - sharded.stats->dropped);
+	TEST_ASSERT(output[0] == 'a');
+	TEST_ASSERT(strcmp(&output[output_len - 4], "UVbz") == 0);
+
+	return true;
+}
+
+#if LOGGER_BINARY
+
+static uint8_t frame[LOGGER_FRAME_SIZE];
+static size_t frame_len;
+
+/* Keeps the frame as it is */
+static void frame_cb(const char *str, size_t length)
+{
+	memcpy(frame, str, length);
+	frame_len = length;
+}
+
+static uint32_t frame_clock_cb(void)
+{
+	return 0x00010000;
+}
+
+static bool test_logger_frame(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &frame_cb, 2, STR_SIZE(32));
+	log.clock_cb = &frame_clock_cb;
+
+	/* The format string is not dereferenced, its address, the timestamp
+	 and the arguments hold zero bytes (little-endian): */
+	const char *fmt = (const char *)(uintptr_t)0x12003400;
+	TEST_ASSERT(logger_put_typed(&log, 2, LOGGER_ARG_INT |
+				     LOGGER_ARG_UINT << 4, fmt, 0,
+				     0x00ff0000u));
+
+	TEST_ASSERT(logger_process(&log));
+
+	/* Each zero byte is replaced by the offset of the next one: */
+	static const uint8_t expected[] = {
+		0x03, 0x22 | (LOGGER_STRING_COPY ? 0x80 : 0), 0x08, /* Header */
+		0x02, 0x34, 0x02, 0x12,		/* Format string address */
+#if (UINTPTR_MAX > UINT32_MAX)
+		0x01, 0x01, 0x01, 0x01,
+#endif
+		0x01, 0x02, 0x01,		/* Timestamp */
+		0x02, 0x21,			/* Argument types */
+		0x01, 0x01, 0x01, 0x01, 0x01, 0x02, 0xff, /* Arguments */
+		0x01, 0x00,			/* Frame delimiter */
+	};
+
+	TEST_ASSERT(frame_len == sizeof(expected));
+	TEST_ASSERT(memcmp(frame, expected, sizeof(expected)) == 0);
+
+	/* The decoded payload is the record: */
+	uint8_t payload[LOGGER_PAYLOAD_SIZE];
+	TEST_ASSERT(frame_decode(frame, frame_len - 1, payload) ==
+		    2 + sizeof(fmt) + 4 + 1 + 8);
+	TEST_ASSERT(memcmp(&payload[2], &fmt, sizeof(fmt)) == 0);
+	TEST_ASSERT(payload[sizeof(fmt) + 4] == 0x01);
+	TEST_ASSERT(payload[sizeof(fmt) + 13] == 0xff);
+
+	return true;
+}
+
+#endif
+
+bool test_logger(void)
+{
+	bool status = true;
+
+	status &= TEST_RUN(test_logger_fifo);
+#if LOGGER_BINARY
+	status &= TEST_RUN(test_logger_frame);
+#else
+	/* Formatting on the target: */
+	status &= TEST_RUN(test_logger_types);
+	status &= TEST_RUN(test_logger_typed);
+	status &= TEST_RUN(test_logger_format);
+	status &= TEST_RUN(test_logger_max_argc);
+#endif
+	status &= TEST_RUN(test_logger_fifo_short);
+	status &= TEST_RUN(test_logger_timestamp);
+	status &= TEST_RUN(test_logger_level);
+	status &= TEST_RUN(test_logger_lockfree);
+	status &= TEST_RUN(test_logger_stats);
+	status &= TEST_RUN(test_logger_overwrite);
+	status &= TEST_RUN(test_logger_block);
+#if !LOGGER_BINARY
+	status &= TEST_RUN(test_logger_batch);
+	status &= TEST_RUN(test_logger_stream);
+#endif
+	status &= TEST_RUN(test_logger_sharded);
+	status &= TEST_RUN(test_logger_snapshot);
+
+	return status;
+}
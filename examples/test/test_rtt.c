@@ -0,0 +1,114 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#include "test_rtt.h"
+#include "test.h"
+#include <string.h>
+#include <mcu-common/rtt.h>
+
+/* Reads data from the up buffer as the host would do */
+static size_t host_read(struct rtt_cb *rtt, char *dst, size_t length)
+{
+	struct rtt_buffer *b = &rtt->up[0];
+	size_t n = 0;
+
+	while (n < length && b->rd_off != b->wr_off) {
+		dst[n++] = b->buffer[b->rd_off];
+		b->rd_off = (b->rd_off + 1) % b->size;
+	}
+
+	return n;
+}
+
+static bool test_rtt_init(void)
+{
+	static struct rtt_cb rtt;
+	TEST_ASSERT(rtt_init(&rtt));
+
+	TEST_ASSERT(strcmp(rtt.id, "SEGGER RTT") == 0);
+	TEST_ASSERT(rtt.max_up == RTT_MAX_UP_BUFFERS);
+	TEST_ASSERT(rtt.max_down == 0);
+
+	/* Not configured buffers are disabled: */
+	TEST_ASSERT(rtt_write(&rtt, 0, "a", 1) == 0);
+	TEST_ASSERT(rtt_writable(&rtt, 0) == 0);
+
+	RTT_CONFIG_UP(&rtt, 0, "Terminal", 8, RTT_MODE_NO_BLOCK_SKIP);
+	TEST_ASSERT(strcmp(rtt.up[0].name, "Terminal") == 0);
+	TEST_ASSERT(rtt.up[0].size == 8);
+	TEST_ASSERT(rtt_writable(&rtt, 0) == 7);
+
+	TEST_ASSERT(!rtt_config_up(&rtt, RTT_MAX_UP_BUFFERS, NULL,
+				   rtt.up[0].buffer, 8,
+				   RTT_MODE_NO_BLOCK_SKIP));
+
+	return true;
+}
+
+static bool test_rtt_modes(void)
+{
+	static struct rtt_cb rtt;
+	char str[8] = {0};
+
+	rtt_init(&rtt);
+	RTT_CONFIG_UP(&rtt, 0, NULL, 8, RTT_MODE_NO_BLOCK_SKIP);
+
+	TEST_ASSERT(rtt_write(&rtt, 0, "abcde", 5) == 5);
+
+	/* Data which do not fit are skipped or trimmed: */
+	TEST_ASSERT(rtt_write(&rtt, 0, "fgh", 3) == 0);
+	rtt.up[0].flags = RTT_MODE_NO_BLOCK_TRIM;
+	TEST_ASSERT(rtt_write(&rtt, 0, "fgh", 3) == 2);
+	TEST_ASSERT(rtt_writable(&rtt, 0) == 0);
+
+	TEST_ASSERT(host_read(&rtt, str, sizeof(str)) == 7);
+	TEST_ASSERT(strcmp(str, "abcdefg") == 0);
+
+	/* Writes wrap around the end of the buffer: */
+	TEST_ASSERT(rtt_write(&rtt, 0, "012345", 6) == 6);
+	TEST_ASSERT(rtt.up[0].wr_off == 5);
+	memset(str, 0, sizeof(str));
+	TEST_ASSERT(host_read(&rtt, str, sizeof(str)) == 6);
+	TEST_ASSERT(strcmp(str, "012345") == 0);
+
+	return true;
+}
+
+bool test_rtt(void)
+{
+	bool status = true;
+
+	status &= TEST_RUN(test_rtt_init);
+	status &= TEST_RUN(test_rtt_modes);
+
+	return status;
+}
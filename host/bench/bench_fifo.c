@@ -0,0 +1,480 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#include "bench_fifo.h"
+#include "bench.h"
+#include "cycles.h"
+#include <stdio.h>
+#include <string.h>
+#include <mcu-common/fifo.h>
+#include <mcu-common/fifo_pow2.h>
+#include <mcu-common/fifo_typed.h>
+#include <mcu-common/logger.h>
+#include <mcu-common/macros.h>
+
+#define BENCH_BYTES	(64u << 20)	/* Bytes transferred per measurement */
+#define CHUNK_BYTES	128u		/* Bytes per read/write call */
+#define FIFO_CAPACITY	1024u		/* Bytes */
+#define BENCH_OPS	(16u << 20)	/* Operations per measurement */
+#define OPS_CAPACITY	64u		/* Elements */
+
+DECLARE_FIFO(char_fifo, char, OPS_CAPACITY);
+DECLARE_FIFO(u32_fifo, uint32_t, OPS_CAPACITY);
+
+typedef size_t (*fifo_rw_fn)(struct fifo *fifo, void *data, size_t count);
+
+/* Element-by-element implementation used before bulk copies (reference) */
+static size_t fifo_read_bytewise(struct fifo *fifo, void *dst, size_t count)
+{
+	size_t n = 0;
+	char *ptr = dst;
+	size_t tail = fifo->tail;
+
+	while (n < count) {
+		if (tail == fifo->head) /* Fifo empty */
+			break;
+
+		size_t i = tail * fifo->element_size;
+		for (size_t j = 0; j < fifo->element_size; j++)
+			*(ptr++) = ((char *)fifo->buffer)[i+j];
+
+		if (++tail == fifo->buffer_capacity)
+			tail = 0;
+
+		n++;
+	}
+
+	if (n)
+		fifo->tail = tail;
+
+	return n;
+}
+
+static size_t fifo_write_bytewise(struct fifo *fifo, void *src, size_t count)
+{
+	size_t n = 0;
+	const char *ptr = src;
+	size_t head = fifo->head;
+
+	while (n < count) {
+		size_t next_head = head + 1;
+		if (next_head == fifo->buffer_capacity)
+			next_head = 0;
+
+		if (next_head == fifo->tail) /* Fifo full */
+			break;
+
+		size_t i = head * fifo->element_size;
+		for (size_t j = 0; j < fifo->element_size; j++)
+			((char *)fifo->buffer)[i+j] = *(ptr++);
+
+		head = next_head;
+		n++;
+	}
+
+	if (n)
+		fifo->head = head;
+
+	return n;
+}
+
+/* Character-by-character fifo_gets()/fifo_puts() used before (reference) */
+static size_t fifo_gets_bytewise(struct fifo *fifo, char *str)
+{
+	size_t n = 0;
+	size_t tail = fifo->tail;
+	size_t head = fifo->head;
+
+	while (tail != head) {
+		str[n] = ((char *)fifo->buffer)[tail];
+
+		if (++tail == fifo->buffer_capacity)
+			tail = 0;
+
+		if (!str[n])
+			break;
+
+		n++;
+	}
+
+	str[n] = '\0';
+	fifo->tail = tail;
+
+	return n;
+}
+
+static size_t fifo_puts_bytewise(struct fifo *fifo, const char *str)
+{
+	size_t n = 0;
+	char *lastptr = NULL;
+	size_t head = fifo->head;
+	size_t tail = fifo->tail;
+
+	while (true) {
+		size_t next_head = head + 1;
+		if (next_head == fifo->buffer_capacity)
+			next_head = 0;
+
+		if (next_head == tail) { /* Fifo full */
+			if (lastptr) {
+				*lastptr = '\0';
+				n--;
+			}
+			break;
+		}
+
+		lastptr = &((char *)fifo->buffer)[head];
+		*lastptr = str[n];
+		head = next_head;
+
+		if (!str[n])
+			break;
+
+		n++;
+	}
+
+	fifo->head = head;
+
+	return n;
+}
+
+static size_t fifo_write_bulk(struct fifo *fifo, void *src, size_t count)
+{
+	return fifo_write(fifo, src, count);
+}
+
+static double measure(size_t elem_size, fifo_rw_fn write_fn,
+		      fifo_rw_fn read_fn)
+{
+	static char buffer[FIFO_CAPACITY + sizeof(struct logger_entry)];
+	static char in[CHUNK_BYTES + sizeof(struct logger_entry)];
+	static char out[CHUNK_BYTES + sizeof(struct logger_entry)];
+
+	struct fifo fifo;
+	fifo.buffer = buffer;
+	fifo.element_size = elem_size;
+	fifo.buffer_capacity = FIFO_CAPACITY / elem_size + 1;
+	fifo_init(&fifo);
+
+	size_t chunk = CHUNK_BYTES / elem_size;
+	if (chunk == 0)
+		chunk = 1;
+
+	for (size_t i = 0; i < sizeof(in); i++)
+		in[i] = (char)i;
+
+	/* Offset the indexes so that the transfers keep crossing the wrap */
+	size_t offset = fifo.buffer_capacity / 3;
+	write_fn(&fifo, in, offset);
+	read_fn(&fifo, out, offset);
+
+	size_t bytes = 0;
+	uint64_t start = bench_ns();
+
+	while (bytes < BENCH_BYTES) {
+		size_t n = write_fn(&fifo, in, chunk);
+		read_fn(&fifo, out, n);
+		bytes += n * elem_size;
+	}
+
+	uint64_t elapsed = bench_ns() - start;
+
+	if (memcmp(in, out, chunk * elem_size) != 0)
+		BENCH_PRINTF("  data mismatch!\n");
+
+	return (double)bytes * 1e9 / (double)elapsed;
+}
+
+static void bench_fifo_read_write(void)
+{
+	static const size_t sizes[] = {
+		1, 4, 8, sizeof(struct logger_entry)
+	};
+
+	BENCH_PRINTF("  %-12s %14s %14s %8s\n", "element_size", "bytewise MB/s",
+		     "bulk MB/s", "speedup");
+
+	for (size_t i = 0; i < ARRAY_SIZE(sizes); i++) {
+		double ref = measure(sizes[i], &fifo_write_bytewise,
+				     &fifo_read_bytewise);
+		double bulk = measure(sizes[i], &fifo_write_bulk, &fifo_read);
+
+		BENCH_PRINTF("  %-12zu %14.1f %14.1f %7.2fx\n", sizes[i],
+			     ref / 1e6, bulk / 1e6, bulk / ref);
+	}
+}
+
+/* Costs per operation are in cycles (see cycles_read()) to be comparable with
+ the DWT cycle counts measured on the target by test_fifo_single_cycles */
+static double measure_ops(size_t elem_size)
+{
+	static char buffer[sizeof(struct logger_entry)*(OPS_CAPACITY+1)];
+	static char data[sizeof(struct logger_entry)];
+
+	struct fifo fifo;
+	fifo.buffer = buffer;
+	fifo.element_size = elem_size;
+	fifo.buffer_capacity = OPS_CAPACITY+1;
+	fifo_init(&fifo);
+
+	size_t n = 0;
+	uint32_t start = cycles_read();
+
+	for (size_t i = 0; i < BENCH_OPS; i++) {
+		if (fifo_writable(&fifo) > 0)
+			n += fifo_write(&fifo, data, 1);
+		if (i & 1)
+			n += fifo_read(&fifo, data, 1);
+		if (fifo_readable(&fifo) == OPS_CAPACITY)
+			n += fifo_read(&fifo, data, 1);
+	}
+
+	uint32_t elapsed = cycles_read() - start;
+	if (n == 0)
+		BENCH_PRINTF("  no data transferred!\n");
+
+	return (double)elapsed / BENCH_OPS;
+}
+
+static double measure_ops_pow2(size_t elem_size)
+{
+	static char buffer[sizeof(struct logger_entry)*OPS_CAPACITY];
+	static char data[sizeof(struct logger_entry)];
+
+	struct fifo_pow2 fifo;
+	fifo.buffer = buffer;
+	fifo.element_size = elem_size;
+	fifo.capacity = OPS_CAPACITY;
+	fifo_pow2_init(&fifo);
+
+	size_t n = 0;
+	uint32_t start = cycles_read();
+
+	for (size_t i = 0; i < BENCH_OPS; i++) {
+		if (fifo_pow2_writable(&fifo) > 0)
+			n += fifo_pow2_write(&fifo, data, 1);
+		if (i & 1)
+			n += fifo_pow2_read(&fifo, data, 1);
+		if (fifo_pow2_readable(&fifo) == OPS_CAPACITY)
+			n += fifo_pow2_read(&fifo, data, 1);
+	}
+
+	uint32_t elapsed = cycles_read() - start;
+	if (n == 0)
+		BENCH_PRINTF("  no data transferred!\n");
+
+	return (double)elapsed / BENCH_OPS;
+}
+
+static void bench_fifo_pow2(void)
+{
+	/* Power-of-two element sizes only (see fifo_pow2.element_size) */
+	static const size_t sizes[] = {
+		1, 4, 64
+	};
+
+	BENCH_PRINTF("  %-12s %14s %14s %8s\n", "element_size", "fifo cyc/op",
+		     "fifo_pow2 cyc/op", "speedup");
+
+	for (size_t i = 0; i < ARRAY_SIZE(sizes); i++) {
+		double ref = measure_ops(sizes[i]);
+		double pow2 = measure_ops_pow2(sizes[i]);
+
+		BENCH_PRINTF("  %-12zu %14.2f %14.2f %7.2fx\n", sizes[i],
+			     ref, pow2, ref / pow2);
+	}
+}
+
+#define STR_LINE	"AT+CWJAP=\"access-point\",\"passphrase\""
+#define STR_LINES	(4u << 20)	/* Strings per measurement */
+
+enum str_mode { STR_BYTEWISE, STR_BULK, STR_RECORD };
+
+static double measure_str(enum str_mode mode)
+{
+	static char buffer[FIFO_CAPACITY];
+	char str[sizeof(STR_LINE)];
+	size_t len = strlen(STR_LINE);
+
+	struct fifo fifo;
+	fifo.buffer = buffer;
+	fifo.element_size = 1;
+	fifo.buffer_capacity = sizeof(buffer);
+	fifo_init(&fifo);
+
+	size_t n = 0;
+	uint64_t start = bench_ns();
+
+	for (size_t i = 0; i < STR_LINES; i++) {
+		switch (mode) {
+		case STR_BYTEWISE:
+			fifo_puts_bytewise(&fifo, STR_LINE);
+			n += fifo_gets_bytewise(&fifo, str);
+			break;
+		case STR_BULK:
+			fifo_puts(&fifo, STR_LINE);
+			n += fifo_ngets(&fifo, str, sizeof(str));
+			break;
+		case STR_RECORD:
+			fifo_write_str(&fifo, STR_LINE, len);
+			n += (size_t)fifo_read_str(&fifo, str, sizeof(str));
+			break;
+		}
+	}
+
+	uint64_t elapsed = bench_ns() - start;
+	if (n != STR_LINES * len)
+		BENCH_PRINTF("  strings corrupted!\n");
+
+	return (double)elapsed / STR_LINES;
+}
+
+static void bench_fifo_str(void)
+{
+	BENCH_PRINTF("  %-12s %14s %8s\n", "functions", "ns/string",
+		     "speedup");
+
+	double ref = measure_str(STR_BYTEWISE);
+	double bulk = measure_str(STR_BULK);
+	double record = measure_str(STR_RECORD);
+
+	BENCH_PRINTF("  %-12s %14.2f\n", "bytewise", ref);
+	BENCH_PRINTF("  %-12s %14.2f %7.2fx\n", "puts/ngets", bulk,
+		     ref / bulk);
+	BENCH_PRINTF("  %-12s %14.2f %7.2fx\n", "*_str", record,
+		     ref / record);
+}
+
+/* The same sequence of operations as measure_ops() */
+static double measure_ops_single(size_t elem_size)
+{
+	static char buffer[sizeof(struct logger_entry)*(OPS_CAPACITY+1)];
+	static char data[sizeof(struct logger_entry)];
+
+	struct fifo fifo;
+	fifo.buffer = buffer;
+	fifo.element_size = elem_size;
+	fifo.buffer_capacity = OPS_CAPACITY+1;
+	fifo_init(&fifo);
+
+	size_t n = 0;
+	uint32_t start = cycles_read();
+
+	for (size_t i = 0; i < BENCH_OPS; i++) {
+		if (fifo_writable(&fifo) > 0)
+			n += fifo_push1(&fifo, data);
+		if (i & 1)
+			n += fifo_pop1(&fifo, data);
+		if (fifo_readable(&fifo) == OPS_CAPACITY)
+			n += fifo_pop1(&fifo, data);
+	}
+
+	uint32_t elapsed = cycles_read() - start;
+	if (n == 0)
+		BENCH_PRINTF("  no data transferred!\n");
+
+	return (double)elapsed / BENCH_OPS;
+}
+
+static void bench_fifo_single(void)
+{
+	static const size_t sizes[] = {
+		1, 4, sizeof(struct logger_entry)
+	};
+
+	BENCH_PRINTF("  %-12s %14s %14s %8s\n", "element_size", "fifo cyc/op",
+		     "push1/pop1 cyc/op", "speedup");
+
+	for (size_t i = 0; i < ARRAY_SIZE(sizes); i++) {
+		double ref = measure_ops(sizes[i]);
+		double single = measure_ops_single(sizes[i]);
+
+		BENCH_PRINTF("  %-12zu %14.2f %14.2f %7.2fx\n", sizes[i],
+			     ref, single, ref / single);
+	}
+}
+
+/* The same sequence of operations as measure_ops() */
+#define MEASURE_OPS_TYPED(name, type) \
+	static double measure_ops_##name(void) \
+	{ \
+		static struct name fifo; \
+		type data = 0; \
+		\
+		name##_init(&fifo); \
+		\
+		size_t n = 0; \
+		uint32_t start = cycles_read(); \
+		\
+		for (size_t i = 0; i < BENCH_OPS; i++) { \
+			if (name##_writable(&fifo) > 0) \
+				n += name##_push(&fifo, data); \
+			if (i & 1) \
+				n += name##_pop(&fifo, &data); \
+			if (name##_readable(&fifo) == OPS_CAPACITY) \
+				n += name##_pop(&fifo, &data); \
+		} \
+		\
+		uint32_t elapsed = cycles_read() - start; \
+		if (n == 0) \
+			BENCH_PRINTF("  no data transferred!\n"); \
+		\
+		return (double)elapsed / BENCH_OPS; \
+	}
+
+MEASURE_OPS_TYPED(char_fifo, char)
+MEASURE_OPS_TYPED(u32_fifo, uint32_t)
+
+static void bench_fifo_typed(void)
+{
+	BENCH_PRINTF("  %-12s %14s %14s %8s\n", "element", "fifo cyc/op",
+		     "typed cyc/op", "speedup");
+
+	double ref = measure_ops(sizeof(char));
+	double typed = measure_ops_char_fifo();
+	BENCH_PRINTF("  %-12s %14.2f %14.2f %7.2fx\n", "char", ref, typed,
+		     ref / typed);
+
+	ref = measure_ops(sizeof(uint32_t));
+	typed = measure_ops_u32_fifo();
+	BENCH_PRINTF("  %-12s %14.2f %14.2f %7.2fx\n", "uint32_t", ref, typed,
+		     ref / typed);
+}
+
+void bench_fifo(void)
+{
+	BENCH_RUN(bench_fifo_read_write);
+	BENCH_RUN(bench_fifo_pow2);
+	BENCH_RUN(bench_fifo_typed);
+	BENCH_RUN(bench_fifo_single);
+	BENCH_RUN(bench_fifo_str);
+}
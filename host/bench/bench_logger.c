@@ -0,0 +1,125 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#include "bench_logger.h"
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <mcu-common/logger.h>
+#include <mcu-common/macros.h>
+
+#define BENCH_MESSAGES	(1u << 20)	/* Messages per measurement */
+#define BATCH_SIZE	16u		/* Messages per logger_process_batch() */
+
+typedef size_t (*process_fn)(const struct logger *log, size_t max_count,
+			     uint32_t max_time);
+
+static char output[1024];
+static size_t output_len;
+
+static void write_cb(const char *str, size_t length)
+{
+	/* Keep the first batch for comparison: */
+	if (output_len + length < sizeof(output)) {
+		memcpy(&output[output_len], str, length);
+		output_len += length;
+		output[output_len] = '\0';
+	}
+}
+
+static uint32_t time_now;
+
+static uint32_t clock_cb(void)
+{
+	return time_now++;
+}
+
+/* Messages logged by the examples */
+static void put_messages(struct logger *log, size_t count, unsigned int i)
+{
+	for (size_t n = 0; n < count; n += 4) {
+		LOGGER_PUT(log, "Hello World!\n");
+		LOGGER_PUT(log, "Six args: [ %d, %d, %d, %d, %d, %d ]\n",
+			   10, 20, 30, 40, 50, (int)i);
+		LOGGER_PUT(log, "%s(): i=%d\n", __func__, (int)i);
+		LOGGER_PUT(log, "%s: 0x%08x %5u %c\n", "reg", 0xdeadbeefu,
+			   i, 'x');
+	}
+}
+
+static double measure(process_fn process, bool timestamped)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, BATCH_SIZE*4, BATCH_SIZE*64);
+
+	uint64_t elapsed = 0;
+	output_len = 0;
+	time_now = 0;
+
+	for (unsigned int i = 0; i < BENCH_MESSAGES / BATCH_SIZE; i++) {
+		log.clock_cb = timestamped ? &clock_cb : NULL;
+		put_messages(&log, BATCH_SIZE, i);
+
+		uint64_t start = bench_ns();
+		process(&log, BATCH_SIZE, 0);
+		elapsed += bench_ns() - start;
+	}
+
+	return (double)elapsed / BENCH_MESSAGES;
+}
+
+static void bench_logger_format(void)
+{
+	static char ref[sizeof(output)];
+
+	BENCH_PRINTF("  %-12s %14s %14s %8s\n", "timestamp", "snprintf ns/msg",
+		     "builtin ns/msg", "speedup");
+
+	for (int timestamped = 0; timestamped <= 1; timestamped++) {
+		double std = measure(&logger_process_batch, timestamped);
+		memcpy(ref, output, sizeof(ref));
+
+		double builtin = measure(&logger_builtin_process_batch,
+					 timestamped);
+		if (strcmp(ref, output) != 0)
+			BENCH_PRINTF("  output mismatch!\n");
+
+		BENCH_PRINTF("  %-12s %14.1f %14.1f %7.2fx\n",
+			     timestamped ? "yes" : "no", std, builtin,
+			     std / builtin);
+	}
+}
+
+void bench_logger(void)
+{
+	BENCH_RUN(bench_logger_format);
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+/*
+ * The logger module compiled with the built-in formatter and renamed, so that
+ * the benchmark can compare it with the default (snprintf) one. Both share the
+ * logger structures, so the entries can be logged by the default functions.
+ */
+
+#define LOGGER_BUILTIN_FORMAT	1
+
+#define logger_init		logger_builtin_init
+#define logger_put		logger_builtin_put
+#define logger_put_typed	logger_builtin_put_typed
+#define logger_process		logger_builtin_process
+#define logger_process_batch	logger_builtin_process_batch
+#define logger_snapshot		logger_builtin_snapshot
+
+#include "../../src/logger.c"
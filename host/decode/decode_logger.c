@@ -0,0 +1,92 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+
+/*
+ * Logs a set of messages and writes them to stdout. Built twice by the host
+ * Makefile: with the default output and with #LOGGER_BINARY, the frames of the
+ * latter are decoded by tools/logger_decode.py (looking the format strings up
+ * in this program's ELF file) and compared with the former.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <mcu-common/logger.h>
+
+static void write_cb(const char *str, size_t length)
+{
+	fwrite(str, 1, length, stdout);
+}
+
+static uint32_t clock_cb(void)
+{
+	static uint32_t time = 4000000000u;
+	return time++;
+}
+
+int main(void)
+{
+	static struct logger log;
+	LOGGER_INIT(&log, &write_cb, 16, LOGGER_FRAME_SIZE + 64);
+
+	/* Integers: */
+	LOGGER_PUT(&log, "%d %i %u %x %X %o\n", -42, 42, 4000000000u, 0xbeefu,
+		   0xbeefu, 8u);
+	LOGGER_PUT(&log, "%5d|%-5d|%05d|%+d|% d|%#x\n", 1, 2, -3, 4, 5, 255u);
+	LOGGER_PUT(&log, "%lld %llu %ld %hhd %hu\n", LLONG_MIN, ULLONG_MAX,
+		   -5L, (signed char)-100, (unsigned short)65535);
+	LOGGER_PUT(&log, "%*d|%-*x|%.*d\n", 6, 1, 6, 0xa, 4, 5);
+	while (logger_process(&log));
+
+	/* Characters, strings, pointers and floating-point numbers: */
+	const char *volatile null_str = NULL;
+	LOGGER_PUT(&log, "%c%c %s|%8s|%-6.2s|\n", 'o', 'k', "str", "str",
+		   "str");
+	LOGGER_PUT(&log, "%s|%5s|\n", null_str, "");
+	LOGGER_PUT(&log, "%p 100%%\n", (void *)0x1234);
+	LOGGER_PUT(&log, "%.2f %e %g %5.1f\n", 3.14159, 1.5e10, 0.25, -2.5);
+	while (logger_process(&log));
+
+	/* Conversions without arguments: */
+	logger_put_typed(&log, 1, LOGGER_ARG_INT, "%d %s %d\n", 7);
+
+	/* Timestamps and dropped messages: */
+	log.clock_cb = &clock_cb;
+	int i = 0;
+	while (LOGGER_PUT(&log, "%d\n", i))
+		i++;
+	while (logger_process(&log));
+	LOGGER_PUT(&log, "%s\n", "done");
+	while (logger_process(&log));
+
+	return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+/*
+ * Multi-threaded stress test of the SPSC FIFOs: one producer and one consumer
+ * thread transfer a sequence of counters in chunks of varying size and the
+ * consumer verifies that every element arrives exactly once and in order.
+ * In the flight recorder mode, the consumer takes snapshots of the FIFO
+ * overwritten by the producer and verifies that each holds consecutive
+ * counters. Build with `make -C host tsan` to run it under ThreadSanitizer.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <mcu-common/fifo.h>
+#include <mcu-common/fifo_pow2.h>
+
+#define STRESS_COUNT	(4u << 20)	/* Elements per test */
+#define MAX_CHUNK	37u		/* Elements per read/write call */
+
+enum stress_mode {
+	STRESS_COPY,		/* fifo_read()/fifo_write() */
+	STRESS_ZERO_COPY,	/* fifo_reserve()/fifo_acquire() */
+	STRESS_POW2,		/* fifo_pow2_read()/fifo_pow2_write() */
+	STRESS_SNAPSHOT,	/* fifo_snapshot()/fifo_write_overwrite() */
+};
+
+struct stress {
+	enum stress_mode mode;
+	struct fifo fifo;
+	struct fifo_pow2 fifo_pow2;
+	size_t errors;
+};
+
+static size_t chunk_size(uint32_t *seed)
+{
+	*seed = *seed * 1103515245u + 12345u;
+	return 1 + (*seed >> 16) % MAX_CHUNK;
+}
+
+static size_t produce(struct stress *s, const uint32_t *src, size_t count)
+{
+	uint32_t *ptr;
+	size_t n;
+
+	switch (s->mode) {
+	case STRESS_COPY:
+		return fifo_write(&s->fifo, src, count);
+	case STRESS_ZERO_COPY:
+		n = fifo_reserve(&s->fifo, (void **)&ptr);
+		if (n > count)
+			n = count;
+		for (size_t i = 0; i < n; i++)
+			ptr[i] = src[i];
+		fifo_commit(&s->fifo, n);
+		return n;
+	case STRESS_POW2:
+		return fifo_pow2_write(&s->fifo_pow2, src, count);
+	case STRESS_SNAPSHOT:
+		fifo_write_overwrite(&s->fifo, src, count);
+		return count;
+	}
+
+	return 0;
+}
+
+static size_t consume(struct stress *s, uint32_t *dst, size_t count)
+{
+	uint32_t *ptr;
+	size_t n;
+
+	switch (s->mode) {
+	case STRESS_COPY:
+		return fifo_read(&s->fifo, dst, count);
+	case STRESS_ZERO_COPY:
+		n = fifo_acquire(&s->fifo, (void **)&ptr);
+		if (n > count)
+			n = count;
+		for (size_t i = 0; i < n; i++)
+			dst[i] = ptr[i];
+		fifo_release(&s->fifo, n);
+		return n;
+	case STRESS_POW2:
+		return fifo_pow2_read(&s->fifo_pow2, dst, count);
+	case STRESS_SNAPSHOT:
+		break;
+	}
+
+	return 0;
+}
+
+static void *producer(void *arg)
+{
+	struct stress *s = arg;
+	uint32_t seed = 1;
+	uint32_t buf[MAX_CHUNK];
+	uint32_t next = 0;
+
+	while (next < STRESS_COUNT) {
+		size_t count = chunk_size(&seed);
+		if (count > STRESS_COUNT - next)
+			count = STRESS_COUNT - next;
+
+		for (size_t i = 0; i < count; i++)
+			buf[i] = next + i;
+
+		size_t n = produce(s, buf, count);
+		next += n;
+		if (n == 0)
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+static void *consumer(void *arg)
+{
+	struct stress *s = arg;
+	uint32_t seed = 2;
+	uint32_t buf[MAX_CHUNK];
+	uint32_t expected = 0;
+
+	while (expected < STRESS_COUNT) {
+		size_t n = consume(s, buf, chunk_size(&seed));
+		for (size_t i = 0; i < n; i++) {
+			if (buf[i] != expected++)
+				s->errors++;
+		}
+		if (n == 0)
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+static void *snapshotter(void *arg)
+{
+	struct stress *s = arg;
+	uint32_t buf[100];
+	uint32_t first = 0;
+	uint32_t last = 0;
+
+	/* Each snapshot holds consecutive counters, not older than the
+	 previous one: */
+	while (last < STRESS_COUNT - 1) {
+		size_t n = fifo_snapshot(&s->fifo, buf, 100);
+		if (n == 0) {
+			sched_yield();
+			continue;
+		}
+
+		if (buf[0] < first || buf[n-1] < last)
+			s->errors++;
+		for (size_t i = 1; i < n; i++) {
+			if (buf[i] != buf[i-1] + 1)
+				s->errors++;
+		}
+
+		first = buf[0];
+		last = buf[n-1];
+	}
+
+	return NULL;
+}
+
+static bool stress_run(const char *name, enum stress_mode mode)
+{
+	static struct stress s;
+	pthread_t threads[2];
+
+	s.mode = mode;
+	s.errors = 0;
+	FIFO_INIT(&s.fifo, sizeof(uint32_t), 100);
+	FIFO_POW2_INIT(&s.fifo_pow2, sizeof(uint32_t), 128);
+
+	pthread_create(&threads[0], NULL, &producer, &s);
+	pthread_create(&threads[1], NULL, (mode == STRESS_SNAPSHOT) ?
+		       &snapshotter : &consumer, &s);
+	pthread_join(threads[0], NULL);
+	pthread_join(threads[1], NULL);
+
+	bool status = (s.errors == 0);
+	printf("%-23s [%s]\n", name, status ? "PASS" : "FAIL");
+
+	return status;
+}
+
+int main(void)
+{
+	bool status = true;
+
+	printf("mcu-common: stress tests\n");
+
+	status &= stress_run("stress_fifo_copy", STRESS_COPY);
+	status &= stress_run("stress_fifo_zero_copy", STRESS_ZERO_COPY);
+	status &= stress_run("stress_fifo_pow2", STRESS_POW2);
+	status &= stress_run("stress_fifo_snapshot", STRESS_SNAPSHOT);
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+/*
+ * Multi-threaded stress test of the lock-free logger queue and the sharded
+ * logger: several producer threads log numbered messages concurrently while
+ * the main thread processes them and verifies that no message is lost,
+ * duplicated, reordered (within a producer) or torn.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <mcu-common/logger.h>
+
+#define PRODUCERS	4
+#define STRESS_COUNT	(256u << 10)	/* Messages per producer */
+
+static struct logger *log;
+static _Thread_local unsigned int shard;
+static unsigned int expected[PRODUCERS];
+static size_t received;
+static size_t errors;
+
+static unsigned int checksum(unsigned int id, unsigned int seq)
+{
+	return (id * 2654435761u) ^ (seq * 40503u);
+}
+
+static void write_cb(const char *str, size_t length)
+{
+	unsigned int id, seq, sum;
+
+	(void)length;
+
+	if (sscanf(str, "%u %u %u", &id, &seq, &sum) != 3 || id >= PRODUCERS ||
+	    seq != expected[id] || sum != checksum(id, seq)) {
+		errors++;
+		return;
+	}
+
+	expected[id]++;
+	received++;
+}
+
+static void *producer(void *arg)
+{
+	unsigned int id = (unsigned int)(size_t)arg;
+
+	/* Each producer has its own shard (if sharded): */
+	shard = id;
+
+	/* Blocks while the queue is full (LOGGER_BLOCK): */
+	for (unsigned int seq = 0; seq < STRESS_COUNT; seq++)
+		LOGGER_PUT(log, "%u %u %u\n", id, seq, checksum(id, seq));
+
+	return NULL;
+}
+
+static unsigned int shard_cb(void)
+{
+	return shard;
+}
+
+static bool stress_run(const char *name)
+{
+	pthread_t threads[PRODUCERS];
+
+	for (size_t i = 0; i < PRODUCERS; i++)
+		expected[i] = 0;
+	received = 0;
+	errors = 0;
+
+	for (size_t i = 0; i < PRODUCERS; i++)
+		pthread_create(&threads[i], NULL, &producer, (void *)i);
+
+	while (received < PRODUCERS * STRESS_COUNT && errors == 0) {
+		if (!logger_process(log))
+			sched_yield();
+	}
+
+	for (size_t i = 0; i < PRODUCERS; i++)
+		pthread_join(threads[i], NULL);
+
+	bool status = (errors == 0 && !logger_process(log) &&
+		       log->stats->dropped == 0);
+	printf("%-23s [%s]\n", name, status ? "PASS" : "FAIL");
+
+	return status;
+}
+
+int main(void)
+{
+	static struct logger log_lockfree;
+	static struct logger log_sharded;
+	bool status = true;
+
+	printf("mcu-common: stress tests\n");
+
+	LOGGER_INIT_LOCKFREE(&log_lockfree, &write_cb, 256, 64);
+	log_lockfree.overflow = LOGGER_BLOCK;
+	log = &log_lockfree;
+	status &= stress_run("stress_logger_lockfree");
+
+	LOGGER_INIT_SHARDED(&log_sharded, &write_cb, PRODUCERS, 64, 64);
+	log_sharded.overflow = LOGGER_BLOCK;
+	log_sharded.shard_cb = &shard_cb;
+	log = &log_sharded;
+	status &= stress_run("stress_logger_sharded");
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
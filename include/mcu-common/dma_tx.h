@@ -0,0 +1,102 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#ifndef MCU_COMMON_DMA_TX_H
+#define MCU_COMMON_DMA_TX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <mcu-common/fifo.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @addtogroup dma_tx_module
+ @{ */
+
+/**
+ * Initializes the #dma_tx instance and allocates its @ref fifo_module buffer.
+ *
+ * @param tx            Pointer to the #dma_tx structure
+ * @param tx_start_cb   Pointer to start callback implemented by driver
+ *                      (see dma_tx.start_cb for details)
+ * @param tx_capacity   Capacity of the transmit buffer in bytes
+ */
+#define DMA_TX_INIT(tx, tx_start_cb, tx_capacity) \
+	do { \
+		static struct fifo dma_tx_fifo; \
+		FIFO_INIT(&dma_tx_fifo, 1, (tx_capacity)); \
+		(tx)->fifo = &dma_tx_fifo; \
+		(tx)->start_cb = (tx_start_cb); \
+		(tx)->max_transfer = 0; \
+		dma_tx_init((tx)); \
+	} while (0)
+
+/** DMA transmit channel instance */
+struct dma_tx {
+	/**
+	  * Pointer to start callback implemented by driver.
+	  *
+	  * The callback is supposed to configure the DMA controller to
+	  * transfer `length` bytes from `data` to the peripheral and start
+	  * the transfer. The driver must call dma_tx_complete() when the
+	  * transfer is complete (i.e. from the transfer complete interrupt).
+	  * The data stay valid until then.
+	  *
+	  * @param[in] data     Pointer to the data to be transferred
+	  * @param length       Number of bytes to be transferred
+	  */
+	void (*start_cb)(const void *data, size_t length);
+	/** Pointer to #fifo instance holding the data to be transferred
+	 (element size must be 1) */
+	struct fifo *fifo;
+	/** Maximum length of a single transfer (e.g. limited by the DMA
+	 counter width), `0` means no limit */
+	size_t max_transfer;
+	/** Length of the transfer in progress, `0` if idle (handled
+	 internally) */
+	volatile size_t pending;
+};
+
+bool dma_tx_init(struct dma_tx *tx);
+size_t dma_tx_write(struct dma_tx *tx, const void *data, size_t length);
+void dma_tx_complete(struct dma_tx *tx);
+bool dma_tx_busy(const struct dma_tx *tx);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCU_COMMON_DMA_TX_H */
@@ -32,8 +32,10 @@
 #ifndef MCU_COMMON_FIFO_H
 #define MCU_COMMON_FIFO_H
 
+#include <assert.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <mcu-common/sync.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,16 +44,28 @@ extern "C" {
 /** @addtogroup fifo_module
  @{ */
 
+/**
+ * Largest element size copied inline by fifo_push1() and fifo_pop1(), larger
+ * elements fall back to fifo_write() and fifo_read().
+ */
+#ifndef FIFO_INLINE_SIZE_MAX
+#define FIFO_INLINE_SIZE_MAX	8
+#endif
+
 /**
  * Allocates buffer and initializes #fifo instance.
  *
+ * The buffer is suitably aligned for any element type so the elements can be
+ * accessed in place (see fifo_reserve() and fifo_acquire()).
+ *
  * @param fifo          Pointer to the #fifo structure
  * @param elem_size     Size of a single element (see fifo.element_size)
  * @param fifo_capacity Maximum number of elements in FIFO
  */
 #define FIFO_INIT(fifo, elem_size, fifo_capacity) \
 	do { \
-		static char buffer[(elem_size)*((fifo_capacity)+1)]; \
+		static char buffer[(elem_size)*((fifo_capacity)+1)] \
+			__attribute__((aligned)); \
 		(fifo)->buffer = buffer; \
 		(fifo)->element_size = (elem_size); \
 		(fifo)->buffer_capacity = (fifo_capacity)+1; \
@@ -71,9 +85,12 @@ struct fifo {
 	 is wasted for lock-free operation) */
 	size_t buffer_capacity;
 	/** Read index (handled internally) */
-	volatile size_t tail;
+	sync_size_t tail;
 	/** Write index (handled internally) */
-	volatile size_t head;
+	sync_size_t head;
+	/** Number of elements overwritten by the producer (handled internally,
+	 see fifo_write_overwrite()) */
+	sync_size_t overwritten;
 };
 
 bool fifo_init(struct fifo *fifo);
@@ -85,8 +102,101 @@ size_t fifo_writable(const struct fifo *fifo);
 size_t fifo_read(struct fifo *fifo, void *dst, size_t count);
 size_t fifo_write(struct fifo *fifo, const void *src, size_t count);
 
+size_t fifo_reserve(struct fifo *fifo, void **ptr);
+void fifo_commit(struct fifo *fifo, size_t count);
+size_t fifo_acquire(struct fifo *fifo, void **ptr);
+void fifo_release(struct fifo *fifo, size_t count);
+size_t fifo_peek(const struct fifo *fifo, size_t offset, void *dst,
+		 size_t count);
+size_t fifo_skip(struct fifo *fifo, size_t count);
+bool fifo_find(const struct fifo *fifo, size_t offset, char c, size_t *pos);
+size_t fifo_read_until(struct fifo *fifo, void *dst, size_t count, char delim);
+
+size_t fifo_write_overwrite(struct fifo *fifo, const void *src, size_t count);
+void fifo_discard(struct fifo *fifo, size_t count);
+size_t fifo_snapshot(const struct fifo *fifo, void *dst, size_t count);
+
 size_t fifo_gets(struct fifo *fifo, char *str);
+size_t fifo_ngets(struct fifo *fifo, char *str, size_t size);
 size_t fifo_puts(struct fifo *fifo, const char *str);
+bool fifo_write_str(struct fifo *fifo, const char *str, size_t len);
+ptrdiff_t fifo_read_str(struct fifo *fifo, char *str, size_t size);
+
+/**
+ * Writes a single element to FIFO.
+ *
+ * Inline variant of fifo_write() with `count == 1` for hot paths such as
+ * interrupt handlers. Elements up to #FIFO_INLINE_SIZE_MAX bytes are stored
+ * directly.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[in] src       Pointer to the element written
+ *
+ * @return `true` if the element has been written, `false` if FIFO is full
+ */
+static inline bool fifo_push1(struct fifo *fifo, const void *src)
+{
+	assert(fifo != NULL);
+	assert(src != NULL);
+
+	if (fifo->element_size > FIFO_INLINE_SIZE_MAX)
+		return fifo_write(fifo, src, 1) == 1;
+
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head);
+	size_t next = head + 1;
+	if (next == fifo->buffer_capacity)
+		next = 0;
+
+	if (next == SYNC_LOAD_ACQUIRE(&fifo->tail))
+		return false;
+
+	char *buffer = &((char *)fifo->buffer)[head * fifo->element_size];
+	const char *data = (const char *)src;
+	for (size_t i = 0; i < fifo->element_size; i++)
+		buffer[i] = data[i];
+
+	SYNC_STORE_RELEASE(&fifo->head, next);
+
+	return true;
+}
+
+/**
+ * Reads a single element from FIFO.
+ *
+ * Inline variant of fifo_read() with `count == 1` for hot paths such as
+ * interrupt handlers. Elements up to #FIFO_INLINE_SIZE_MAX bytes are loaded
+ * directly.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[out] dst      Pointer to the element read
+ *
+ * @return `true` if an element has been read, `false` if FIFO is empty
+ */
+static inline bool fifo_pop1(struct fifo *fifo, void *dst)
+{
+	assert(fifo != NULL);
+	assert(dst != NULL);
+
+	if (fifo->element_size > FIFO_INLINE_SIZE_MAX)
+		return fifo_read(fifo, dst, 1) == 1;
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	if (tail == SYNC_LOAD_ACQUIRE(&fifo->head))
+		return false;
+
+	const char *buffer =
+		&((const char *)fifo->buffer)[tail * fifo->element_size];
+	char *data = (char *)dst;
+	for (size_t i = 0; i < fifo->element_size; i++)
+		data[i] = buffer[i];
+
+	if (++tail == fifo->buffer_capacity)
+		tail = 0;
+
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
+
+	return true;
+}
 
 /**@}*/
 
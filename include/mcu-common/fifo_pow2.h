@@ -0,0 +1,107 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#ifndef MCU_COMMON_FIFO_POW2_H
+#define MCU_COMMON_FIFO_POW2_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <mcu-common/macros.h>
+#include <mcu-common/sync.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @addtogroup fifo_pow2_module
+ @{ */
+
+/**
+ * Allocates buffer and initializes #fifo_pow2 instance.
+ *
+ * @param fifo          Pointer to the #fifo_pow2 structure
+ * @param elem_size     Size of a single element (must be a power of two,
+ *                      see fifo_pow2.element_size)
+ * @param fifo_capacity Maximum number of elements in FIFO (must be a power
+ *                      of two)
+ */
+#define FIFO_POW2_INIT(fifo, elem_size, fifo_capacity) \
+	do { \
+		STATIC_ASSERT((fifo_capacity) > 0 && \
+			      ((fifo_capacity) & ((fifo_capacity)-1)) == 0, \
+			      "FIFO capacity must be a power of two"); \
+		STATIC_ASSERT((elem_size) > 0 && \
+			      ((elem_size) & ((elem_size)-1)) == 0, \
+			      "FIFO element size must be a power of two"); \
+		static char buffer[(elem_size)*(fifo_capacity)] \
+			__attribute__((aligned)); \
+		(fifo)->buffer = buffer; \
+		(fifo)->element_size = (elem_size); \
+		(fifo)->capacity = (fifo_capacity); \
+		fifo_pow2_init(fifo); \
+	} while (0)
+
+/** Power-of-two FIFO instance */
+struct fifo_pow2 {
+	/** Pointer to the buffer holding FIFO elements.
+	 Its size must be (#element_size * #capacity) bytes. */
+	void *buffer;
+	/** Size of a single element (must be a power of two, use the
+	 @ref fifo_typed_module for other element types) */
+	size_t element_size;
+	/** Binary logarithm of #element_size (handled internally) */
+	unsigned int element_shift;
+	/** Number of elements the buffer can hold (must be a power of two,
+	 the whole buffer is used) */
+	size_t capacity;
+	/** Free-running read counter (handled internally) */
+	sync_size_t tail;
+	/** Free-running write counter (handled internally) */
+	sync_size_t head;
+};
+
+bool fifo_pow2_init(struct fifo_pow2 *fifo);
+
+size_t fifo_pow2_capacity(const struct fifo_pow2 *fifo);
+size_t fifo_pow2_readable(const struct fifo_pow2 *fifo);
+size_t fifo_pow2_writable(const struct fifo_pow2 *fifo);
+
+size_t fifo_pow2_read(struct fifo_pow2 *fifo, void *dst, size_t count);
+size_t fifo_pow2_write(struct fifo_pow2 *fifo, const void *src, size_t count);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCU_COMMON_FIFO_POW2_H */
@@ -0,0 +1,138 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+
+#ifndef MCU_COMMON_FIFO_TYPED_H
+#define MCU_COMMON_FIFO_TYPED_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <mcu-common/macros.h>
+#include <mcu-common/sync.h>
+
+/**
+ * @defgroup fifo_typed_module Typed FIFO
+ * FIFO specialized for an element type and capacity at compile time
+ *
+ * DECLARE_FIFO() generates a FIFO structure holding the elements of the given
+ * type and `static inline` functions accessing it. Unlike the generic
+ * @ref fifo_module, the element size and the capacity are constants, so each
+ * push and pop compiles to a single load or store of the element and a
+ * constant mask of the free-running indexes (the capacity must be a power of
+ * two, see @ref fifo_pow2_module). The generic module remains the choice for
+ * FIFOs sized at run time.
+ *
+ * As the other FIFOs, it is safe for a single producer and a single consumer
+ * without locking.
+ *
+ * Example:
+ * @code
+ * DECLARE_FIFO(rx_fifo, uint8_t, 64);
+ *
+ * static struct rx_fifo rx;
+ *
+ * rx_fifo_init(&rx);
+ * rx_fifo_push(&rx, byte);
+ * @endcode
+ @{ */
+
+/**
+ * Declares a typed FIFO.
+ *
+ * Generates structure `struct name` and the following functions:
+ *
+ * - `void name_init(struct name *fifo)` (the zero-initialized static
+ *   structure is initialized as well)
+ * - `size_t name_readable(const struct name *fifo)`
+ * - `size_t name_writable(const struct name *fifo)`
+ * - `bool name_push(struct name *fifo, type val)` returns `false` if full
+ * - `bool name_pop(struct name *fifo, type *val)` returns `false` if empty
+ *
+ * @param name          Name of the structure and prefix of the functions
+ * @param type          Type of the elements
+ * @param capacity      Maximum number of elements in FIFO (must be a power of
+ *                      two)
+ */
+#define DECLARE_FIFO(name, type, capacity) \
+	struct name { \
+		/* Elements of the FIFO */ \
+		type buffer[(capacity)]; \
+		/* Free-running read counter */ \
+		sync_size_t tail; \
+		/* Free-running write counter */ \
+		sync_size_t head; \
+	}; \
+	\
+	static inline void name##_init(struct name *fifo) \
+	{ \
+		SYNC_STORE_RELAXED(&fifo->head, 0); \
+		SYNC_STORE_RELAXED(&fifo->tail, 0); \
+	} \
+	\
+	static inline size_t name##_readable(const struct name *fifo) \
+	{ \
+		size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail); \
+		return SYNC_LOAD_ACQUIRE(&fifo->head) - tail; \
+	} \
+	\
+	static inline size_t name##_writable(const struct name *fifo) \
+	{ \
+		size_t head = SYNC_LOAD_ACQUIRE(&fifo->head); \
+		return (capacity) - (head - SYNC_LOAD_ACQUIRE(&fifo->tail)); \
+	} \
+	\
+	static inline bool name##_push(struct name *fifo, type val) \
+	{ \
+		size_t head = SYNC_LOAD_RELAXED(&fifo->head); \
+		if (head - SYNC_LOAD_ACQUIRE(&fifo->tail) == (capacity)) \
+			return false; \
+		fifo->buffer[head & ((capacity)-1)] = val; \
+		SYNC_STORE_RELEASE(&fifo->head, head + 1); \
+		return true; \
+	} \
+	\
+	static inline bool name##_pop(struct name *fifo, type *val) \
+	{ \
+		size_t tail = SYNC_LOAD_RELAXED(&fifo->tail); \
+		if (SYNC_LOAD_ACQUIRE(&fifo->head) == tail) \
+			return false; \
+		*val = fifo->buffer[tail & ((capacity)-1)]; \
+		SYNC_STORE_RELEASE(&fifo->tail, tail + 1); \
+		return true; \
+	} \
+	\
+	STATIC_ASSERT((capacity) > 0 && ((capacity) & ((capacity)-1)) == 0, \
+		      "FIFO capacity must be a power of two")
+
+/**@}*/
+
+#endif /* MCU_COMMON_FIFO_TYPED_H */
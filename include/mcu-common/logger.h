@@ -37,6 +37,7 @@
 #include <inttypes.h>
 #include <mcu-common/macros.h>
 #include <mcu-common/fifo.h>
+#include <mcu-common/sync.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,26 +45,305 @@ extern "C" {
 
 /**
  * The maximum number of logger_put() arguments supported by the implementation
+ * (may be raised up to 16 at the cost of a larger #logger_entry and lock-free
+ * queue slot, see #LOGGER_ARGS_SIZE).
+ *
+ * LOGGER_PUT() with more arguments fails to compile, messages with more than
+ * 6 arguments (e.g. a line of 8 to 12 sensor values) need
+ * `-DLOGGER_MAX_ARGC=16`.
  * @ingroup logger_module
  */
 #ifndef LOGGER_MAX_ARGC
 #define LOGGER_MAX_ARGC 6
 #endif
 
-/** Logger entry (used internally) */
-/* TODO: Packed, uint8_t for argc? */
+/**
+ * Maximum size of a copied string argument including the terminating null
+ * character (`0` disables copying).
+ *
+ * By default, only the pointer passed to a `%s` conversion is stored and the
+ * string is read by logger_process() later, so it must be static (e.g. a
+ * string literal). If set, the string is copied to the entry by logger_put()
+ * instead (truncated to fit), so that strings on stack can be logged as well.
+ * Consider increasing #LOGGER_ARGS_SIZE accordingly.
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_STRING_COPY
+#define LOGGER_STRING_COPY 0
+#endif
+
+/**
+ * Size of the buffer for argument values stored in a logger entry.
+ *
+ * The arguments are stored with their actual sizes (e.g. 8 bytes for `double`
+ * or `long long`). The default size (6 bytes per argument) fits
+ * #LOGGER_MAX_ARGC arguments if at most half of them take 8 bytes, and a
+ * single copied string (see #LOGGER_STRING_COPY). Arguments which do not fit
+ * are not stored (and neither is the rest of the message).
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_ARGS_SIZE
+#define LOGGER_ARGS_SIZE (LOGGER_MAX_ARGC*6 + LOGGER_STRING_COPY)
+#endif
+
+/**
+ * Enables compile-time tagging of argument types by LOGGER_PUT().
+ *
+ * If set to 1 (the default for C11 and later), LOGGER_PUT() encodes the type
+ * of each argument (see #logger_arg_type) using `_Generic` and passes the tags
+ * to logger_put_typed(), so the format string is not parsed by logger_put()
+ * and the arguments are stored and rendered with their actual types. Passing
+ * an argument of an unsupported type (e.g. a structure) fails to compile.
+ * The arguments are still checked against the format string by the compiler
+ * (`-Wformat`), see LOGGER_FORMAT_CHECK(). Otherwise LOGGER_PUT() calls
+ * logger_put() which derives the types from the format string conversions.
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_TYPED
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__cplusplus)
+#define LOGGER_TYPED 1
+#else
+#define LOGGER_TYPED 0
+#endif
+#endif
+
+/**
+ * Enables the built-in formatter.
+ *
+ * If set to 1, logger_process() formats the messages by a small built-in
+ * formatter instead of `snprintf`, so the C library's `printf` implementation
+ * does not need to be linked (saving flash, stack and possibly heap usage).
+ * It supports `%d %i %u %o %x %X %c %s %p` conversions with flags, width and
+ * precision (the length modifiers are ignored as the arguments are rendered
+ * with their stored types). Floating-point conversions are output as they are
+ * in the format string.
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_BUILTIN_FORMAT
+#define LOGGER_BUILTIN_FORMAT 0
+#endif
+
+/**
+ * Enables binary output (deferred formatting on the host).
+ *
+ * If set to 1, logger_process() does not call `sprintf` but passes a binary
+ * frame holding the raw entry (format string address and arguments) to
+ * logger.write_cb. The frames are decoded by `tools/logger_decode.py` which
+ * looks the format strings up in the firmware's ELF file.
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_BINARY
+#define LOGGER_BINARY 0
+#endif
+
+/**
+ * Maximum size of a binary frame passed to logger.write_cb (see
+ * #LOGGER_BINARY). The string buffer must be at least this large.
+ * @ingroup logger_module
+ */
+#define LOGGER_FRAME_SIZE \
+	(LOGGER_PAYLOAD_SIZE + LOGGER_PAYLOAD_SIZE/254 + 2)
+
+/* Size of the binary frame payload (header, size of arguments, fmt, timestamp,
+ argument types and arguments) */
+#define LOGGER_PAYLOAD_SIZE \
+	(2 + sizeof(const char *) + sizeof(uint32_t) + \
+	 (LOGGER_MAX_ARGC+1)/2 + LOGGER_ARGS_SIZE)
+
+/* Maximum size of a record in the FIFO (the payload and a sequence number of
+ a sharded logger) */
+#define LOGGER_RECORD_MAX_SIZE	(LOGGER_PAYLOAD_SIZE + sizeof(uint32_t))
+
+/**
+ * Average size of a message in the FIFO used to size it by LOGGER_INIT() and
+ * LOGGER_INIT_SHARDED().
+ *
+ * The default fits a timestamped message with four `int` arguments. Messages
+ * are stored as variable-length records, so more shorter messages fit.
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_MESSAGE_SIZE
+#define LOGGER_MESSAGE_SIZE \
+	(2 + sizeof(const char *) + sizeof(uint32_t) + 2 + 4*sizeof(int))
+#endif
+
+/**
+ * Size of the FIFO buffer holding `log_capacity` messages of
+ * #LOGGER_MESSAGE_SIZE bytes (at least a single record of the maximum size)
+ * @ingroup logger_module
+ */
+#define LOGGER_FIFO_SIZE(log_capacity) \
+	((log_capacity)*LOGGER_MESSAGE_SIZE > LOGGER_RECORD_MAX_SIZE ? \
+	 (log_capacity)*LOGGER_MESSAGE_SIZE : LOGGER_RECORD_MAX_SIZE)
+
+/**
+ * Format of the timestamp prefix (see logger.clock_cb)
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_TIMESTAMP_FMT
+#define LOGGER_TIMESTAMP_FMT "[%10" PRIu32 "] "
+#endif
+
+/**
+ * @name Log levels
+ * Severity levels for LOGGER_PUT_LEVEL()
+ * @ingroup logger_module
+ @{ */
+#define LOGGER_LEVEL_TRACE	0
+#define LOGGER_LEVEL_DEBUG	1
+#define LOGGER_LEVEL_INFO	2
+#define LOGGER_LEVEL_WARN	3
+#define LOGGER_LEVEL_ERROR	4
+/**@}*/
+
+/**
+ * Minimum level of messages logged by LOGGER_PUT_LEVEL(). Messages with lower
+ * levels are removed at compile time (including their arguments).
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL LOGGER_LEVEL_TRACE
+#endif
+
+/**
+ * Format of the message reporting the number of messages dropped since the
+ * last logger_process() call (see logger.stats)
+ * @ingroup logger_module
+ */
+#ifndef LOGGER_DROPPED_FMT
+#define LOGGER_DROPPED_FMT "%u messages dropped\n"
+#endif
+
+/**
+ * Types of stored logger arguments (after the default argument promotions)
+ *
+ * Each argument of a #logger_entry is tagged by one of the types in 4 bits of
+ * logger_entry.types (the first argument in the lowest bits).
+ * @ingroup logger_module
+ */
+enum logger_arg_type {
+	LOGGER_ARG_NONE = 0,
+	LOGGER_ARG_INT,
+	LOGGER_ARG_UINT,
+	LOGGER_ARG_LONG,
+	LOGGER_ARG_ULONG,
+	LOGGER_ARG_LLONG,
+	LOGGER_ARG_ULLONG,
+	LOGGER_ARG_DOUBLE,
+	LOGGER_ARG_LDOUBLE,
+	/** Pointer (rendered by `%p`) */
+	LOGGER_ARG_PTR,
+	/** String (copied if #LOGGER_STRING_COPY is set) */
+	LOGGER_ARG_STR,
+};
+
+/**
+ * Logger entry (used internally)
+ *
+ * The entry is stored in the #logger_queue slots as is. The #fifo used by
+ * LOGGER_INIT() holds variable-length records instead, see @ref logger_module.
+ */
 struct logger_entry {
-	/** Number of arguments in #argv (0 to #LOGGER_MAX_ARGC) */
+	/** Number of arguments stored in #args (0 to #LOGGER_MAX_ARGC) */
 	int argc;
 	/** Format string to be passed to `sprintf` */
 	const char *fmt;
-	/** Array of arguments to be passed to `sprintf` */
-	unsigned int argv[LOGGER_MAX_ARGC];
+	/** Entry has a #timestamp */
+	bool timestamped;
+	/** Value returned by logger.clock_cb when the entry was logged */
+	uint32_t timestamp;
+	/** Sequence number used to merge logger shards (see
+	 LOGGER_INIT_SHARDED()) */
+	uint32_t seq;
+	/** Number of bytes used in #args */
+	size_t size;
+	/** Types of the arguments (see #logger_arg_type) */
+	uint64_t types;
+	/** Arguments to be passed to `sprintf`, stored with the sizes given by
+	 #types (without padding) */
+	unsigned char args[LOGGER_ARGS_SIZE];
+};
+
+/** Slot of the lock-free logger queue (used internally) */
+struct logger_slot {
+	/** Sequence number indicating whether the slot is free or holds
+	 a published entry for the given queue position */
+	sync_size_t seq;
+	/** Logged entry */
+	struct logger_entry entry;
+};
+
+/** Lock-free multi-producer, single consumer queue (used internally) */
+struct logger_queue {
+	/** Array of #capacity slots */
+	struct logger_slot *slots;
+	/** Number of slots (must be a power of two) */
+	size_t capacity;
+	/** Position of the next slot to be claimed by a producer */
+	sync_size_t head;
+	/** Position of the next slot to be processed by the consumer */
+	size_t tail;
+};
+
+/** Shard of the sharded logger (used internally) */
+struct logger_shard {
+	/** Single-producer #fifo holding records logged from one context */
+	struct fifo fifo;
+	/** Oldest entry taken from #fifo by logger_process() */
+	struct logger_entry head;
+	/** #head holds an entry which has not been processed yet */
+	bool pending;
+	/** Next record in the logger_snapshot() buffer (used internally) */
+	const uint8_t *snapshot;
+	/** Size of the records left in the logger_snapshot() buffer (used
+	 internally) */
+	size_t snapshot_size;
+};
+
+/** Array of logger shards (used internally) */
+struct logger_shards {
+	/** Array of #count shards */
+	struct logger_shard *shards;
+	/** Number of shards */
+	size_t count;
+	/** Sequence number of the next logged entry */
+	sync_size_t seq;
 };
 
 /** @addtogroup logger_module
  @{ */
 
+/** Behavior of logger_put() when the logger is full */
+enum logger_overflow {
+	/** Drop the new message (default) */
+	LOGGER_DROP_NEWEST,
+	/** Drop the oldest messages to make room for the new one (supported
+	 by LOGGER_INIT() and LOGGER_INIT_SHARDED(), behaves as
+	 #LOGGER_DROP_NEWEST otherwise). The most recent messages can be
+	 written out without removing them by logger_snapshot(). */
+	LOGGER_OVERWRITE_OLDEST,
+	/** Wait until logger_process() makes room for the message or until
+	 logger.block_timeout expires (must not be used in interrupt handlers
+	 with a higher priority than the logger_process() caller) */
+	LOGGER_BLOCK,
+};
+
+/** Logger statistics (see logger.stats) */
+struct logger_stats {
+	/** Number of messages stored by logger_put() */
+	sync_size_t enqueued;
+	/** Number of messages dropped (either by logger_put() or overwritten,
+	 see #logger_overflow) */
+	sync_size_t dropped;
+	/** Maximum number of messages pending for processing */
+	sync_size_t high_water;
+	/** Number of messages processed by logger_process() */
+	sync_size_t processed;
+	/** Value of #dropped reported by logger_process() (used internally) */
+	size_t reported;
+};
+
 /** Logger instance */
 struct logger {
 	/**
@@ -73,17 +353,75 @@ struct logger {
 	  * processing. The callback provides the driver with a string which is
 	  * supposed to be written to the output interface (e.g. serial port).
 	  *
+	  * If the logger has no string buffer (logger.str is `NULL`), the
+	  * message is streamed: The callback is called with consecutive
+	  * chunks of the message (the literal parts of the format string and
+	  * the formatted conversions, short ones gathered in a small buffer
+	  * on stack) as they are rendered, so the driver can copy them
+	  * straight to its transmit buffer and the length of the message is
+	  * not limited.
+	  *
 	  * @param[in] str      Pointer to the string to be written
-	  *                     (formatted by `sprintf`), not null-terminated
+	  *                     (formatted by `sprintf`, or a binary frame if
+	  *                     #LOGGER_BINARY is set), not null-terminated
 	  * @param length       Count of characters to be written
 	  */
 	void (*write_cb)(const char *str, size_t length);
-	/** Pointer to #fifo instance for storing #logger_entry entries */
+	/**
+	  * Pointer to clock callback implemented by driver (optional, may be
+	  * `NULL`).
+	  *
+	  * If set, the callback is called from logger_put() and its return
+	  * value is stored in the entry and printed as a prefix of the message
+	  * (see #LOGGER_TIMESTAMP_FMT). It is supposed to be fast and callable
+	  * from any context, e.g. returning a cycle counter (`DWT->CYCCNT`),
+	  * SysTick-based time or `clock_gettime()` on a host.
+	  *
+	  * @return Current time in arbitrary units
+	  */
+	uint32_t (*clock_cb)(void);
+	/** Pointer to #fifo instance for storing #logger_entry entries
+	 (protected by a critical section) */
 	struct fifo *fifo;
-	/** Pointer to a buffer used to store string composed by `sprintf`. */
+	/** Pointer to #logger_queue instance used instead of #fifo if not
+	 `NULL` (lock-free, see LOGGER_INIT_LOCKFREE()) */
+	struct logger_queue *queue;
+	/** Pointer to #logger_shards used instead of #fifo if not `NULL`
+	 (see LOGGER_INIT_SHARDED()) */
+	struct logger_shards *shards;
+	/**
+	  * Pointer to shard callback implemented by driver (optional, may be
+	  * `NULL`, only used with LOGGER_INIT_SHARDED()).
+	  *
+	  * The callback is called from logger_put() to determine the shard the
+	  * entry is put to. Contexts which can preempt each other (e.g.
+	  * interrupts with different priorities) must use different shards.
+	  * On ARM Cortex-M, the shard can be derived from the priority of the
+	  * active exception (the `IPSR` register is 0 in thread mode).
+	  * If not set, all entries are put to shard 0.
+	  *
+	  * @return Index of the shard for the calling context (must be lower
+	  * than the number of shards)
+	  */
+	unsigned int (*shard_cb)(void);
+	/** Pointer to #logger_stats updated by logger_put() and
+	 logger_process() (optional, may be `NULL`) */
+	struct logger_stats *stats;
+	/** Behavior of logger_put() when the logger is full
+	 (#LOGGER_DROP_NEWEST by default) */
+	enum logger_overflow overflow;
+	/** Maximum time logger_put() waits with #LOGGER_BLOCK in logger.clock_cb
+	 units (`0` or no logger.clock_cb means no timeout) */
+	uint32_t block_timeout;
+	/** Pointer to a buffer used to store string composed by `sprintf`
+	 (`NULL` to stream the messages to logger.write_cb, not supported with
+	 #LOGGER_BINARY) */
 	char *str;
 	/** Size of the string buffer. */
 	size_t str_size;
+	/** Bit mask of modules enabled for LOGGER_PUT_LEVEL() (bit `n`
+	 enables module `n`, all modules are enabled by default) */
+	volatile uint32_t module_mask;
 	/** Logger initialized flag (handled internally) */
 	bool initialized;
 };
@@ -95,26 +433,185 @@ struct logger {
  * @param log           Pointer to the #logger structure
  * @param log_write_cb  Pointer to write callback implemented by driver
  *                      (see logger.write_cb for details)
- * @param log_capacity  Capacity of the internal @ref fifo_module (maximum
- *                      number of messages to be stored, see fifo.capacity)
+ * @param log_capacity  Capacity of the internal @ref fifo_module (number of
+ *                      messages of #LOGGER_MESSAGE_SIZE bytes to be stored,
+ *                      more shorter messages fit, see LOGGER_FIFO_SIZE())
  * @param str_capacity  Capacity of the internal string buffer (should be large
  *                      enough to store a message composed by `snprintf`, see
- *                      logger.str and logger.str_size)
+ *                      logger.str and logger.str_size), see
+ *                      LOGGER_INIT_STREAM() for a logger without it
  */
 #define LOGGER_INIT(log, log_write_cb, log_capacity, str_capacity) \
 	do { \
-		static struct fifo logger_fifo; \
-		FIFO_INIT(&logger_fifo, sizeof(struct logger_entry), \
-			 (log_capacity)); \
+		STATIC_ASSERT((str_capacity) > 0, \
+			      "Use LOGGER_INIT_STREAM() to stream the messages"); \
 		static char str[(str_capacity)]; \
+		LOGGER_INIT_FIFO((log), (log_write_cb), (log_capacity), str, \
+				 sizeof(str)); \
+	} while (0)
+
+/**
+ * Initializes the #logger instance without a string buffer and allocates its
+ * @ref fifo_module buffer.
+ *
+ * The messages are streamed to logger.write_cb in chunks (see
+ * logger.write_cb), so their length is not limited and no RAM is spent on the
+ * string buffer. Not supported with #LOGGER_BINARY.
+ *
+ * @param log           Pointer to the #logger structure
+ * @param log_write_cb  Pointer to write callback implemented by driver
+ *                      (see logger.write_cb for details)
+ * @param log_capacity  Capacity of the internal @ref fifo_module (see
+ *                      LOGGER_INIT())
+ */
+#define LOGGER_INIT_STREAM(log, log_write_cb, log_capacity) \
+	do { \
+		STATIC_ASSERT(!LOGGER_BINARY, \
+			      "Binary frames need a string buffer"); \
+		LOGGER_INIT_FIFO((log), (log_write_cb), (log_capacity), NULL, \
+				 0); \
+	} while (0)
+
+/* Initializes the #logger instance with the given string buffer (used
+ internally by LOGGER_INIT() and LOGGER_INIT_STREAM()) */
+#define LOGGER_INIT_FIFO(log, log_write_cb, log_capacity, log_str, \
+			 log_str_size) \
+	do { \
+		static struct fifo logger_fifo; \
+		FIFO_INIT(&logger_fifo, 1, LOGGER_FIFO_SIZE(log_capacity)); \
+		static struct logger_stats logger_stats; \
 		(log)->fifo = &logger_fifo; \
+		(log)->queue = NULL; \
+		(log)->shards = NULL; \
 		(log)->write_cb = (log_write_cb); \
-		(log)->str = (str); \
+		(log)->clock_cb = NULL; \
+		(log)->shard_cb = NULL; \
+		(log)->module_mask = UINT32_MAX; \
+		(log)->stats = &logger_stats; \
+		(log)->overflow = LOGGER_DROP_NEWEST; \
+		(log)->block_timeout = 0; \
+		(log)->str = (log_str); \
+		(log)->str_size = (log_str_size); \
+		logger_init((log)); \
+	} while (0)
+
+/**
+ * Initializes the #logger instance with a lock-free multi-producer queue and
+ * allocates its string and queue buffers.
+ *
+ * Unlike with LOGGER_INIT(), logger_put() claims queue slots by
+ * compare-and-swap and never disables interrupts. On targets without
+ * compare-and-swap support (ARMv6-M, see @ref sync_defs), the slot is claimed
+ * in a short critical section instead.
+ *
+ * @param log           Pointer to the #logger structure
+ * @param log_write_cb  Pointer to write callback implemented by driver
+ *                      (see logger.write_cb for details)
+ * @param log_capacity  Maximum number of messages to be stored (must be a
+ *                      power of two)
+ * @param str_capacity  Capacity of the internal string buffer (see
+ *                      LOGGER_INIT())
+ */
+#define LOGGER_INIT_LOCKFREE(log, log_write_cb, log_capacity, str_capacity) \
+	do { \
+		STATIC_ASSERT((log_capacity) > 0 && \
+			      ((log_capacity) & ((log_capacity)-1)) == 0, \
+			      "Logger capacity must be a power of two"); \
+		STATIC_ASSERT((str_capacity) > 0, \
+			      "String buffer capacity must be positive"); \
+		static struct logger_slot slots[(log_capacity)]; \
+		static struct logger_queue logger_queue; \
+		static struct logger_stats logger_stats; \
+		static char str[(str_capacity)]; \
+		logger_queue.slots = slots; \
+		logger_queue.capacity = (log_capacity); \
+		(log)->fifo = NULL; \
+		(log)->queue = &logger_queue; \
+		(log)->shards = NULL; \
+		(log)->write_cb = (log_write_cb); \
+		(log)->clock_cb = NULL; \
+		(log)->shard_cb = NULL; \
+		(log)->module_mask = UINT32_MAX; \
+		(log)->stats = &logger_stats; \
+		(log)->overflow = LOGGER_DROP_NEWEST; \
+		(log)->block_timeout = 0; \
+		(log)->str = str; \
 		(log)->str_size = (str_capacity); \
+		logger_init((log)); \
+	} while (0)
+
+/**
+ * Initializes the #logger instance with per-context shards and allocates its
+ * string and shard buffers.
+ *
+ * Each shard is a single-producer @ref fifo_module written by the contexts
+ * which cannot preempt each other (e.g. a single interrupt priority level, see
+ * logger.shard_cb), so logger_put() does not need any locking and a flood of
+ * messages from one context does not take the space of the others.
+ * logger_process() merges the shards in the order of the entries' sequence
+ * numbers (obtained atomically by logger_put(), so the order of entries
+ * logged concurrently may differ slightly from the order they were written
+ * to the shards).
+ *
+ * With #LOGGER_OVERWRITE_OLDEST, each shard is a flight recorder keeping the
+ * most recent messages of its contexts: logger_put() drops the oldest records
+ * of the shard without any locking, so logger_process() must not be called
+ * while other contexts may log (e.g. only from a fault handler), use
+ * logger_snapshot() to write the messages out in the meantime.
+ *
+ * @param log           Pointer to the #logger structure
+ * @param log_write_cb  Pointer to write callback implemented by driver
+ *                      (see logger.write_cb for details)
+ * @param shard_count   Number of shards
+ * @param log_capacity  Capacity of each shard (see LOGGER_INIT())
+ * @param str_capacity  Capacity of the internal string buffer (see
+ *                      LOGGER_INIT())
+ */
+#define LOGGER_INIT_SHARDED(log, log_write_cb, shard_count, log_capacity, \
+			    str_capacity) \
+	do { \
+		STATIC_ASSERT((str_capacity) > 0, \
+			      "String buffer capacity must be positive"); \
+		static struct logger_shard shards[(shard_count)]; \
+		static char shard_buffers[(shard_count)] \
+			[LOGGER_FIFO_SIZE(log_capacity)+1] \
+			__attribute__((aligned)); \
+		static struct logger_shards logger_shards; \
+		static struct logger_stats logger_stats; \
+		static char str[(str_capacity)]; \
+		for (size_t i = 0; i < (shard_count); i++) { \
+			shards[i].fifo.buffer = shard_buffers[i]; \
+			shards[i].fifo.element_size = 1; \
+			shards[i].fifo.buffer_capacity = \
+				sizeof(shard_buffers[i]); \
+		} \
+		logger_shards.shards = shards; \
+		logger_shards.count = (shard_count); \
+		(log)->fifo = NULL; \
+		(log)->queue = NULL; \
+		(log)->shards = &logger_shards; \
 		(log)->write_cb = (log_write_cb); \
+		(log)->clock_cb = NULL; \
+		(log)->shard_cb = NULL; \
+		(log)->module_mask = UINT32_MAX; \
+		(log)->stats = &logger_stats; \
+		(log)->overflow = LOGGER_DROP_NEWEST; \
+		(log)->block_timeout = 0; \
+		(log)->str = str; \
+		(log)->str_size = (str_capacity); \
 		logger_init((log)); \
 	} while (0)
 
+/**
+ * Size of the buffer needed by logger_snapshot().
+ *
+ * @param shard_count   Number of shards (1 for LOGGER_INIT())
+ * @param log_capacity  Capacity of the logger (of each shard, see
+ *                      LOGGER_INIT() and LOGGER_INIT_SHARDED())
+ */
+#define LOGGER_SNAPSHOT_SIZE(shard_count, log_capacity) \
+	((shard_count)*LOGGER_FIFO_SIZE(log_capacity))
+
 /**
  * Logs a message (shortcut for logger_put() which automatically determines
  * the number of arguments).
@@ -123,13 +620,122 @@ struct logger {
  * @param ...   Format string and up to #LOGGER_MAX_ARGC optional arguments
  *              to be passed to `sprintf` (the format string is mandatory).
  */
+#if LOGGER_TYPED
 #define LOGGER_PUT(log, ...) \
-	logger_put((log), VA_ARGC(__VA_ARGS__)-1, __VA_ARGS__)
+	(LOGGER_ARGC_CHECK(__VA_ARGS__), LOGGER_FORMAT_CHECK(__VA_ARGS__), \
+	 logger_put_typed((log), VA_ARGC(__VA_ARGS__)-1, \
+			  (0 VA_FOR_EACH(LOGGER_ARG_TAG, __VA_ARGS__)), \
+			  __VA_ARGS__))
+#else
+#define LOGGER_PUT(log, ...) \
+	(LOGGER_ARGC_CHECK(__VA_ARGS__), \
+	 logger_put((log), VA_ARGC(__VA_ARGS__)-1, __VA_ARGS__))
+#endif
+
+/**
+ * Fails to compile if LOGGER_PUT() is passed more than #LOGGER_MAX_ARGC
+ * arguments (which would not be stored)
+ */
+#define LOGGER_ARGC_CHECK(...) \
+	STATIC_ASSERT_EXPR(VA_COUNT(__VA_ARGS__)-1 <= LOGGER_MAX_ARGC, \
+			   "Too many LOGGER_PUT() arguments, see LOGGER_MAX_ARGC")
+
+#if LOGGER_TYPED
+
+/**
+ * Checks the arguments of LOGGER_PUT() against the format string at compile
+ * time like the `format` attribute of logger_put() (the `printf` call is never
+ * evaluated and is removed by the compiler).
+ */
+#define LOGGER_FORMAT_CHECK(...)	((void)(0 && printf(__VA_ARGS__)))
+
+/* Not defined anywhere: Selected by LOGGER_ARG_TYPE() for unsupported types
+ so that the compilation fails */
+extern const struct logger_unsupported_arg_type logger_unsupported_arg_type;
+
+/**
+ * Type of a logger argument (see #logger_arg_type) determined at compile time
+ *
+ * Unsupported types (e.g. structures) fail to compile. Pointers other than
+ * strings must be cast to `void *` (as required by `%p`).
+ * @ingroup logger_module
+ */
+#define LOGGER_ARG_TYPE(x) _Generic((x), \
+	_Bool: LOGGER_ARG_INT, \
+	char: LOGGER_ARG_INT, \
+	signed char: LOGGER_ARG_INT, \
+	unsigned char: LOGGER_ARG_INT, \
+	short: LOGGER_ARG_INT, \
+	unsigned short: LOGGER_ARG_INT, \
+	int: LOGGER_ARG_INT, \
+	unsigned int: LOGGER_ARG_UINT, \
+	long: LOGGER_ARG_LONG, \
+	unsigned long: LOGGER_ARG_ULONG, \
+	long long: LOGGER_ARG_LLONG, \
+	unsigned long long: LOGGER_ARG_ULLONG, \
+	float: LOGGER_ARG_DOUBLE, \
+	double: LOGGER_ARG_DOUBLE, \
+	long double: LOGGER_ARG_LDOUBLE, \
+	char *: LOGGER_ARG_STR, \
+	const char *: LOGGER_ARG_STR, \
+	void *: LOGGER_ARG_PTR, \
+	const void *: LOGGER_ARG_PTR, \
+	volatile void *: LOGGER_ARG_PTR, \
+	const volatile void *: LOGGER_ARG_PTR, \
+	default: logger_unsupported_arg_type)
+
+/* Tag of the argument at index `i` shifted to its position in the types (the
+ format string at index 0 has no tag, arguments beyond 16 are not stored) */
+#define LOGGER_ARG_TAG(i, x) \
+	| (((i) > 0 && (i) <= 16) ? \
+	   (uint64_t)LOGGER_ARG_TYPE(x) << ((4*(i) - 4) & 63) : 0)
+
+#endif
+
+/**
+ * Logs a message with the given severity level from the given module.
+ *
+ * If `level` is lower than #LOGGER_MIN_LEVEL, the macro compiles to `false`.
+ * Otherwise the module bit in logger.module_mask is checked before any of the
+ * arguments are evaluated and logger_put() is only called for enabled modules.
+ *
+ * @param log           Pointer to the #logger structure
+ * @param level         Log level (e.g. #LOGGER_LEVEL_ERROR)
+ * @param module        Module number (0 to 31)
+ * @param ...           Format string and optional arguments (see LOGGER_PUT())
+ *
+ * @return `true` if the message has been logged, `false` otherwise
+ */
+#define LOGGER_PUT_LEVEL(log, level, module, ...) \
+	(((level) >= LOGGER_MIN_LEVEL && \
+	  ((log)->module_mask & (UINT32_C(1) << (module)))) ? \
+	 LOGGER_PUT((log), __VA_ARGS__) : false)
+
+/** Logs an error message (see LOGGER_PUT_LEVEL()) */
+#define LOGGER_ERROR(log, module, ...) \
+	LOGGER_PUT_LEVEL((log), LOGGER_LEVEL_ERROR, (module), __VA_ARGS__)
+/** Logs a warning message (see LOGGER_PUT_LEVEL()) */
+#define LOGGER_WARN(log, module, ...) \
+	LOGGER_PUT_LEVEL((log), LOGGER_LEVEL_WARN, (module), __VA_ARGS__)
+/** Logs an informational message (see LOGGER_PUT_LEVEL()) */
+#define LOGGER_INFO(log, module, ...) \
+	LOGGER_PUT_LEVEL((log), LOGGER_LEVEL_INFO, (module), __VA_ARGS__)
+/** Logs a debug message (see LOGGER_PUT_LEVEL()) */
+#define LOGGER_DEBUG(log, module, ...) \
+	LOGGER_PUT_LEVEL((log), LOGGER_LEVEL_DEBUG, (module), __VA_ARGS__)
+/** Logs a trace message (see LOGGER_PUT_LEVEL()) */
+#define LOGGER_TRACE(log, module, ...) \
+	LOGGER_PUT_LEVEL((log), LOGGER_LEVEL_TRACE, (module), __VA_ARGS__)
 
 bool logger_init(struct logger *log);
 bool logger_put(const struct logger *log, int argc, const char *fmt, ...)
 		__attribute__((format (printf, 3, 4)));
+bool logger_put_typed(const struct logger *log, int argc, uint64_t types,
+		      const char *fmt, ...);
 bool logger_process(const struct logger *log);
+size_t logger_process_batch(const struct logger *log, size_t max_count,
+			    uint32_t max_time);
+size_t logger_snapshot(const struct logger *log, void *buffer, size_t size);
 
 /**@}*/
 
@@ -37,18 +37,112 @@
  * @defgroup macros_defs Common macros
  */
 
-#define VA_ARGC_IMPL(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, \
-		     a14, a15, a16, n, ...)	(n)
+/* Argument count as a plain number (to be pasted by VA_CONCAT()) */
+#define VA_COUNT_IMPL(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, \
+		      a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, \
+		      a25, a26, a27, a28, a29, a30, a31, a32, n, ...)	n
+#define VA_COUNT(...)	VA_COUNT_IMPL(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, \
+			25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, \
+			12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define VA_CONCAT_IMPL(a, b)	a##b
+#define VA_CONCAT(a, b)		VA_CONCAT_IMPL(a, b)
+
+#define VA_FOR_EACH_1(m, i, a)		m(i, a)
+#define VA_FOR_EACH_2(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_1(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_3(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_2(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_4(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_3(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_5(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_4(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_6(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_5(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_7(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_6(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_8(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_7(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_9(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_8(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_10(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_9(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_11(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_10(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_12(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_11(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_13(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_12(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_14(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_13(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_15(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_14(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_16(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_15(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_17(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_16(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_18(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_17(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_19(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_18(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_20(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_19(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_21(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_20(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_22(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_21(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_23(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_22(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_24(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_23(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_25(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_24(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_26(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_25(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_27(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_26(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_28(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_27(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_29(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_28(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_30(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_29(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_31(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_30(m, i+1, __VA_ARGS__)
+#define VA_FOR_EACH_32(m, i, a, ...)	m(i, a) \
+	VA_FOR_EACH_31(m, i+1, __VA_ARGS__)
 
 /**@{*/
 
-/** Number of arguments for variadic macros (works for up to 16 arguments) */
-#define VA_ARGC(...)	VA_ARGC_IMPL(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, \
-			9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+/** Number of arguments for variadic macros (works for up to 32 arguments) */
+#define VA_ARGC(...)	(VA_COUNT(__VA_ARGS__))
+
+/**
+ * Expands `macro(index, arg)` for each argument of a variadic macro (works
+ * for up to 32 arguments). The index is an expression (e.g. `0+1+1`) which
+ * evaluates to the position of the argument starting from 0.
+ */
+#define VA_FOR_EACH(macro, ...) \
+	VA_CONCAT(VA_FOR_EACH_, VA_COUNT(__VA_ARGS__))(macro, 0, __VA_ARGS__)
 
 /** Size of an array */
 #define ARRAY_SIZE(x)	(sizeof(x)/sizeof(*(x)))
 
+/** Compile-time assertion (works in both C11 and C++11) */
+#ifdef __cplusplus
+#define STATIC_ASSERT(cond, msg)	static_assert(cond, msg)
+#else
+#define STATIC_ASSERT(cond, msg)	_Static_assert(cond, msg)
+#endif
+
+/** Compile-time assertion usable as an expression (of type `void`) */
+#ifdef __cplusplus
+#define STATIC_ASSERT_EXPR(cond, msg)	([]{ static_assert(cond, msg); }())
+#else
+#define STATIC_ASSERT_EXPR(cond, msg) \
+	((void)sizeof(struct { STATIC_ASSERT(cond, msg); int unused; }))
+#endif
+
 /**@}*/
 
 #endif /* MCU_COMMON_MACROS_H */
@@ -0,0 +1,134 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#ifndef MCU_COMMON_RTT_H
+#define MCU_COMMON_RTT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <mcu-common/sync.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @addtogroup rtt_module
+ @{ */
+
+/**
+ * Number of up (target to host) buffers in the #rtt_cb control block
+ */
+#ifndef RTT_MAX_UP_BUFFERS
+#define RTT_MAX_UP_BUFFERS 1
+#endif
+
+/**
+ * Configures an up buffer of the #rtt_cb control block and allocates it.
+ *
+ * @param rtt           Pointer to the #rtt_cb structure (initialized by
+ *                      rtt_init())
+ * @param index         Index of the up buffer (0 to #RTT_MAX_UP_BUFFERS-1)
+ * @param up_name       Name of the buffer displayed by the host
+ * @param up_size       Size of the buffer in bytes (one byte is unused)
+ * @param up_mode       Behavior if the buffer is full (see #rtt_mode)
+ */
+#define RTT_CONFIG_UP(rtt, index, up_name, up_size, up_mode) \
+	do { \
+		static char rtt_up_buffer[(up_size)]; \
+		rtt_config_up((rtt), (index), (up_name), rtt_up_buffer, \
+			      (up_size), (up_mode)); \
+	} while (0)
+
+/** Behavior of rtt_write() if the up buffer is full */
+enum rtt_mode {
+	/** Write nothing if the data do not fit (default) */
+	RTT_MODE_NO_BLOCK_SKIP = 0,
+	/** Write as much data as fits */
+	RTT_MODE_NO_BLOCK_TRIM = 1,
+	/** Wait until the host reads the data (blocks forever if no host
+	 is attached) */
+	RTT_MODE_BLOCK_IF_FULL = 2,
+};
+
+/**
+ * Ring buffer in the #rtt_cb control block.
+ *
+ * The layout matches SEGGER's `SEGGER_RTT_BUFFER_UP`, so the buffer can be
+ * read by SEGGER J-Link tools and other RTT-capable debug probes.
+ */
+struct rtt_buffer {
+	/** Name of the buffer (optional, may be `NULL`) */
+	const char *name;
+	/** Pointer to the buffer */
+	char *buffer;
+	/** Size of the buffer in bytes */
+	unsigned int size;
+	/** Write offset (modified by the target only) */
+	sync_uint_t wr_off;
+	/** Read offset (modified by the host only) */
+	sync_uint_t rd_off;
+	/** Mode (see #rtt_mode) */
+	unsigned int flags;
+};
+
+/**
+ * RTT control block.
+ *
+ * The layout matches SEGGER's `SEGGER_RTT_CB` (without down buffers). The host
+ * finds the control block by searching the target's RAM for the #id string
+ * ("SEGGER RTT").
+ */
+struct rtt_cb {
+	/** Identifier of the control block (set by rtt_init()) */
+	char id[16];
+	/** Number of #up buffers */
+	int max_up;
+	/** Number of down buffers (always 0) */
+	int max_down;
+	/** Up (target to host) buffers */
+	struct rtt_buffer up[RTT_MAX_UP_BUFFERS];
+};
+
+bool rtt_init(struct rtt_cb *rtt);
+bool rtt_config_up(struct rtt_cb *rtt, unsigned int index, const char *name,
+		   char *buffer, size_t size, enum rtt_mode mode);
+size_t rtt_write(struct rtt_cb *rtt, unsigned int index, const void *data,
+		 size_t length);
+size_t rtt_writable(const struct rtt_cb *rtt, unsigned int index);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCU_COMMON_RTT_H */
@@ -0,0 +1,178 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+#ifndef MCU_COMMON_SYNC_H
+#define MCU_COMMON_SYNC_H
+
+/**
+ * Index synchronization macros for lock-free data structures
+ *
+ * Lock-free queues publish data by storing an index after the data has been
+ * written (release) and consume it by loading the index before the data is
+ * read (acquire). If C11 atomics are available, #sync_size_t is an
+ * `atomic_size_t` and the macros map to `atomic_load_explicit()` and
+ * `atomic_store_explicit()` with the respective memory orders, which is
+ * required for correct operation on multi-core or out-of-order targets (and
+ * makes the code analyzable by ThreadSanitizer).
+ *
+ * Otherwise (e.g. pre-C11 compilers or C++), #sync_size_t falls back to
+ * `volatile size_t` and the macros only prevent the compiler from reordering
+ * memory accesses around them, which is sufficient on single-core
+ * microcontrollers where the load or store of `size_t` is a single
+ * instruction.
+ *
+ * With C11 atomics, SYNC_CAS() also provides a compare-and-swap operation for
+ * multi-producer data structures (compiled to `LDREX`/`STREX` loops on
+ * ARMv7-M). It is not available (#SYNC_HAS_CAS is not defined) on ARMv6-M
+ * which lacks exclusive access instructions, the callers are expected to fall
+ * back to a critical section there.
+ *
+ * @defgroup sync_defs Index synchronization macros
+ */
+
+#include <stddef.h>
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_ATOMICS__) && !defined(__cplusplus)
+#include <stdatomic.h>
+#define SYNC_ATOMICS
+/* ARMv6-M lacks exclusive access instructions (compare-and-swap would be
+ emulated by a library call) */
+#if !defined(__ARM_ARCH_6M__)
+#define SYNC_HAS_CAS
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@{*/
+
+#ifdef SYNC_ATOMICS
+
+/** Index shared between a producer and a consumer */
+typedef atomic_size_t sync_size_t;
+
+/** Index of `unsigned int` size (e.g. in a structure with a fixed layout) */
+typedef atomic_uint sync_uint_t;
+
+/** Loads index written by the other side (acquire) */
+#define SYNC_LOAD_ACQUIRE(ptr) \
+	atomic_load_explicit((ptr), memory_order_acquire)
+
+/** Loads index owned by the caller (relaxed) */
+#define SYNC_LOAD_RELAXED(ptr) \
+	atomic_load_explicit((ptr), memory_order_relaxed)
+
+/** Publishes index owned by the caller (release) */
+#define SYNC_STORE_RELEASE(ptr, val) \
+	atomic_store_explicit((ptr), (val), memory_order_release)
+
+/** Stores index without ordering constraints (relaxed) */
+#define SYNC_STORE_RELAXED(ptr, val) \
+	atomic_store_explicit((ptr), (val), memory_order_relaxed)
+
+/** Loads a byte of data which may be stored concurrently (relaxed) */
+#define SYNC_LOAD_BYTE_RELAXED(ptr) \
+	atomic_load_explicit((atomic_uchar *)(ptr), memory_order_relaxed)
+
+/** Stores a byte of data which may be loaded concurrently (relaxed) */
+#define SYNC_STORE_BYTE_RELAXED(ptr, val) \
+	atomic_store_explicit((atomic_uchar *)(ptr), (val), \
+			      memory_order_relaxed)
+
+/** Orders the loads preceding the fence before the loads and stores
+ following it (acquire fence) */
+#define SYNC_FENCE_ACQUIRE() \
+	atomic_thread_fence(memory_order_acquire)
+
+/** Orders the loads and stores preceding the fence before the stores
+ following it (release fence) */
+#define SYNC_FENCE_RELEASE() \
+	atomic_thread_fence(memory_order_release)
+
+#ifdef SYNC_HAS_CAS
+
+/**
+ * Replaces index value by `val` if it equals to `*expected` (relaxed).
+ * Otherwise stores the current index value to `*expected`. May fail
+ * spuriously, so it is supposed to be called in a loop.
+ *
+ * @return `true` if the index has been replaced, `false` otherwise
+ */
+#define SYNC_CAS(ptr, expected, val) \
+	atomic_compare_exchange_weak_explicit((ptr), (expected), (val), \
+					      memory_order_relaxed, \
+					      memory_order_relaxed)
+
+#endif
+
+#else
+
+typedef volatile size_t sync_size_t;
+
+typedef volatile unsigned int sync_uint_t;
+
+#define SYNC_BARRIER()	__asm__ volatile ("" ::: "memory")
+
+#define SYNC_LOAD_ACQUIRE(ptr) \
+	({ size_t _val = *(ptr); SYNC_BARRIER(); _val; })
+
+#define SYNC_LOAD_RELAXED(ptr) \
+	(*(ptr))
+
+#define SYNC_STORE_RELEASE(ptr, val) \
+	do { SYNC_BARRIER(); *(ptr) = (val); } while (0)
+
+#define SYNC_STORE_RELAXED(ptr, val) \
+	do { *(ptr) = (val); } while (0)
+
+#define SYNC_LOAD_BYTE_RELAXED(ptr) \
+	(*(volatile unsigned char *)(ptr))
+
+#define SYNC_STORE_BYTE_RELAXED(ptr, val) \
+	do { *(volatile unsigned char *)(ptr) = (val); } while (0)
+
+#define SYNC_FENCE_ACQUIRE()	SYNC_BARRIER()
+
+#define SYNC_FENCE_RELEASE()	SYNC_BARRIER()
+
+#endif
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCU_COMMON_SYNC_H */
@@ -0,0 +1,162 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+/**
+ * @defgroup dma_tx_module DMA transmit
+ *
+ * Hardware-independent DMA transmit channel backed by a @ref fifo_module
+ *
+ * Data written by dma_tx_write() are stored in the FIFO and transferred to
+ * the peripheral (e.g. UART) by the DMA controller in as few transfers as
+ * possible: Each transfer covers the largest contiguous readable region of
+ * the FIFO (see fifo_acquire()), i.e. at most two transfers are needed to
+ * send the whole FIFO if the data wrap around the end of the buffer.
+ *
+ * The region is only freed when the transfer is complete (dma_tx_complete()
+ * called by the driver), so the DMA controller reads the data directly from
+ * the FIFO buffer and the CPU is only interrupted once per transfer instead of
+ * once per byte.
+ *
+ * The hardware-specific part is implemented by the driver's
+ * dma_tx.start_cb callback and its transfer complete interrupt handler.
+ */
+
+#include <assert.h>
+#include <mcu-common/dma_tx.h>
+#include <mcu-common/critical.h>
+
+/**@{*/
+
+static void dma_tx_start(struct dma_tx *tx);
+
+/**
+ * Initializes DMA transmit channel.
+ *
+ * @param tx Pointer to the #dma_tx structure
+ *
+ * @return `true` if initialization succeeds, `false` otherwise
+ */
+bool dma_tx_init(struct dma_tx *tx)
+{
+	assert(tx != NULL);
+	assert(tx->start_cb != NULL);
+	assert(tx->fifo != NULL);
+	assert(tx->fifo->element_size == 1);
+
+	tx->pending = 0;
+
+	return true;
+}
+
+/**
+ * Writes data to the transmit buffer and starts a transfer if the channel is
+ * idle.
+ *
+ * @param tx            Pointer to the #dma_tx structure
+ * @param[in] data      Pointer to the data to be written
+ * @param length        Number of bytes to be written
+ *
+ * @return Number of bytes written (may be less than `length` if the buffer
+ * is full)
+ */
+size_t dma_tx_write(struct dma_tx *tx, const void *data, size_t length)
+{
+	assert(tx != NULL);
+	assert(data != NULL);
+
+	size_t n;
+
+	CRITICAL_ENTER();
+
+	n = fifo_write(tx->fifo, data, length);
+	if (tx->pending == 0)
+		dma_tx_start(tx);
+
+	CRITICAL_EXIT();
+
+	return n;
+}
+
+/**
+ * Frees the transferred data and starts the next transfer.
+ *
+ * Must be called by the driver when the transfer started by dma_tx.start_cb
+ * is complete (typically from the DMA transfer complete interrupt).
+ *
+ * @param tx Pointer to the #dma_tx structure
+ */
+void dma_tx_complete(struct dma_tx *tx)
+{
+	assert(tx != NULL);
+
+	CRITICAL_ENTER();
+
+	if (tx->pending > 0) {
+		fifo_release(tx->fifo, tx->pending);
+		tx->pending = 0;
+	}
+
+	dma_tx_start(tx);
+
+	CRITICAL_EXIT();
+}
+
+/**
+ * Checks whether a transfer is in progress.
+ *
+ * @param tx Pointer to the #dma_tx structure
+ *
+ * @return `true` if a transfer is in progress, `false` otherwise
+ */
+bool dma_tx_busy(const struct dma_tx *tx)
+{
+	assert(tx != NULL);
+
+	return (tx->pending > 0);
+}
+
+/* Starts a transfer of the contiguous readable region (if any) */
+static void dma_tx_start(struct dma_tx *tx)
+{
+	void *data;
+	size_t n = fifo_acquire(tx->fifo, &data);
+
+	if (tx->max_transfer > 0 && n > tx->max_transfer)
+		n = tx->max_transfer;
+
+	if (n > 0) {
+		tx->pending = n;
+		tx->start_cb(data, n);
+	}
+}
+
+/**@}*/
@@ -42,21 +42,171 @@
  * The lock-free behavior is achieved by having a head index only updated
  * by the producer and a tail index only updated by the consumer, both in an
  * "atomic" way where it does not contain invalid intermediary values.
+ * The producer publishes the head index with release semantics after the data
+ * has been written and the consumer loads it with acquire semantics before
+ * the data is read (and vice versa for the tail index), see @ref sync_defs.
  * To distinguish between the empty `(head == tail)` and full `(head+1 == tail)`
  * states, a single element in the internal buffer is sacrificed as a trade-off
  * for not having a third "full" flag (which would have to be updated by both
  * consumer and producer, requiring a locking mechanism).
  *
+ * Besides copying data with fifo_read() and fifo_write(), the FIFO provides
+ * a two-phase (zero-copy) API: The producer obtains a contiguous writable
+ * region with fifo_reserve(), fills it in place and publishes it with
+ * fifo_commit(). The consumer obtains a contiguous readable region with
+ * fifo_acquire() and frees it with fifo_release() once it has been processed.
+ * Each of the commit/release functions only updates the index owned by its
+ * side, so the lock-free guarantees described above still apply.
+ *
+ * The consumer can also inspect data without removing it with fifo_peek()
+ * and fifo_find() (e.g. to parse a frame header in place) and remove it with
+ * fifo_skip() or fifo_read_until() once a complete frame has been received.
+ *
+ * In the flight recorder mode, the FIFO keeps the most recent elements: The
+ * producer writes by fifo_write_overwrite() which overwrites the oldest
+ * elements when the FIFO is full (the producer then owns the tail index as
+ * well, so there must be no concurrent fifo_read() or other consumer
+ * operation). The retained elements are copied out by fifo_snapshot() which
+ * does not remove them and does not block the producer: It detects elements
+ * overwritten while being copied by a counter which the producer advances
+ * before overwriting them (like a sequence lock) and leaves them out. Both
+ * sides access the elements byte by byte by relaxed atomic loads and stores
+ * in this mode, so the elements read while being overwritten are not a data
+ * race (but they are slower to copy than by memcpy()).
+ *
  * The implementation is thus not lock-free on architectures where loading or
  * storing a `size_t` variable (used for the head and tail indexes) takes more
  * than a single instruction (e.g. 8-bit CPUs).
  */
 
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
 #include <mcu-common/fifo.h>
 
 /**@{*/
 
+static size_t readable(size_t head, size_t tail, size_t capacity)
+{
+	if (head >= tail)
+		return head - tail;
+	else
+		return capacity - tail + head;
+}
+
+static size_t writable(size_t head, size_t tail, size_t capacity)
+{
+	if (head < tail)
+		return tail - head - 1;
+	else
+		return capacity - head + tail - 1;
+}
+
+static size_t advance(size_t index, size_t count, size_t capacity)
+{
+	index += count;
+	if (index >= capacity)
+		index -= capacity;
+
+	return index;
+}
+
+/* Copies count elements from the buffer starting at tail in at most two
+ contiguous segments (up to the end of the buffer and from its beginning),
+ returns the updated tail index */
+static size_t copy_out(const struct fifo *fifo, size_t tail, void *dst,
+		       size_t count)
+{
+	size_t size = fifo->element_size;
+	size_t first = fifo->buffer_capacity - tail;
+	if (first > count)
+		first = count;
+
+	const char *buffer = fifo->buffer;
+	memcpy(dst, &buffer[tail * size], first * size);
+	memcpy((char *)dst + first * size, buffer, (count - first) * size);
+
+	tail = advance(tail, count, fifo->buffer_capacity);
+
+	return tail;
+}
+
+/* Counterpart of copy_out(), returns the updated head index */
+static size_t copy_in(struct fifo *fifo, size_t head, const void *src,
+		      size_t count)
+{
+	size_t size = fifo->element_size;
+	size_t first = fifo->buffer_capacity - head;
+	if (first > count)
+		first = count;
+
+	char *buffer = fifo->buffer;
+	memcpy(&buffer[head * size], src, first * size);
+	memcpy(buffer, (const char *)src + first * size, (count - first) * size);
+
+	head = advance(head, count, fifo->buffer_capacity);
+
+	return head;
+}
+
+/* Counterpart of copy_out() for the flight recorder mode (see fifo_snapshot())
+ loading the elements by relaxed atomic loads */
+static void copy_out_relaxed(const struct fifo *fifo, size_t tail, void *dst,
+			     size_t count)
+{
+	size_t end = fifo->buffer_capacity * fifo->element_size;
+	size_t pos = tail * fifo->element_size;
+	const unsigned char *buffer = fifo->buffer;
+	unsigned char *d = dst;
+
+	for (size_t i = 0; i < count * fifo->element_size; i++) {
+		d[i] = SYNC_LOAD_BYTE_RELAXED(&buffer[pos]);
+		if (++pos == end)
+			pos = 0;
+	}
+}
+
+/* Counterpart of copy_in() for the flight recorder mode storing the elements
+ by relaxed atomic stores, returns the updated head index */
+static size_t copy_in_relaxed(struct fifo *fifo, size_t head, const void *src,
+			      size_t count)
+{
+	size_t end = fifo->buffer_capacity * fifo->element_size;
+	size_t pos = head * fifo->element_size;
+	unsigned char *buffer = fifo->buffer;
+	const unsigned char *s = src;
+
+	for (size_t i = 0; i < count * fifo->element_size; i++) {
+		SYNC_STORE_BYTE_RELAXED(&buffer[pos], s[i]);
+		if (++pos == end)
+			pos = 0;
+	}
+
+	return advance(head, count, fifo->buffer_capacity);
+}
+
+/* Returns offset of the first byte c within count bytes starting at tail
+ (count if not found), scanning at most two contiguous segments with memchr()
+ which the C libraries implement a word at a time */
+static size_t find_byte(const struct fifo *fifo, size_t tail, size_t count,
+			int c)
+{
+	const char *buffer = fifo->buffer;
+	size_t first = fifo->buffer_capacity - tail;
+	if (first > count)
+		first = count;
+
+	const char *p = memchr(&buffer[tail], c, first);
+	if (p)
+		return (size_t)(p - &buffer[tail]);
+
+	p = memchr(buffer, c, count - first);
+	if (p)
+		return first + (size_t)(p - buffer);
+
+	return count;
+}
+
 /**
  * Initializes FIFO.
  *
@@ -71,8 +221,9 @@ bool fifo_init(struct fifo *fifo)
 	assert(fifo->element_size > 0);
 	assert(fifo->buffer_capacity > 1);
 
-	fifo->head = 0;
-	fifo->tail = 0;
+	SYNC_STORE_RELAXED(&fifo->head, 0);
+	SYNC_STORE_RELAXED(&fifo->tail, 0);
+	SYNC_STORE_RELAXED(&fifo->overwritten, 0);
 
 	return true;
 }
@@ -102,15 +253,10 @@ size_t fifo_readable(const struct fifo *fifo)
 {
 	assert(fifo != NULL);
 
-	size_t head = fifo->head;
-	size_t tail = fifo->tail;
+	size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
 
-	if (head == tail)
-		return 0;
-	else if (head > tail)
-		return head - tail;
-	else
-		return fifo->buffer_capacity - tail + head;
+	return readable(head, tail, fifo->buffer_capacity);
 }
 
 /**
@@ -124,13 +270,10 @@ size_t fifo_writable(const struct fifo *fifo)
 {
 	assert(fifo != NULL);
 
-	size_t head = fifo->head;
-	size_t tail = fifo->tail;
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
 
-	if (head < tail)
-		return tail - head - 1;
-	else
-		return fifo->buffer_capacity - head + tail - 1;
+	return writable(head, tail, fifo->buffer_capacity);
 }
 
 /**
@@ -147,28 +290,20 @@ size_t fifo_read(struct fifo *fifo, void *dst, size_t count)
 	assert(fifo != NULL);
 	assert(dst != NULL);
 
-	size_t n = 0;
-	char *ptr = dst;
-	size_t tail = fifo->tail;
-
-	while (n < count) {
-		if (tail == fifo->head) /* Fifo empty */
-			break;
-
-		size_t i = tail * fifo->element_size;
-		for (size_t j = 0; j < fifo->element_size; j++)
-			*(ptr++) = ((char *)fifo->buffer)[i+j];
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n = readable(head, tail, fifo->buffer_capacity);
 
-		if (++tail == fifo->buffer_capacity)
-			tail = 0;
+	if (count > n)
+		count = n;
 
-		n++;
-	}
+	if (!count)
+		return 0;
 
-	if (n)
-		fifo->tail = tail;
+	tail = copy_out(fifo, tail, dst, count);
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
 
-	return n;
+	return count;
 }
 
 /**
@@ -185,71 +320,457 @@ size_t fifo_write(struct fifo *fifo, const void *src, size_t count)
 	assert(fifo != NULL);
 	assert(src != NULL);
 
-	size_t n = 0;
-	const char *ptr = src;
-	size_t head = fifo->head;
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head);
+	size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
+	size_t n = writable(head, tail, fifo->buffer_capacity);
 
-	while (n < count) {
-		size_t next_head = head + 1;
-		if (next_head == fifo->buffer_capacity)
-			next_head = 0;
+	if (count > n)
+		count = n;
 
-		if (next_head == fifo->tail) /* Fifo full */
-			break;
+	if (!count)
+		return 0;
 
-		size_t i = head * fifo->element_size;
-		for (size_t j = 0; j < fifo->element_size; j++)
-			((char *)fifo->buffer)[i+j] = *(ptr++);
+	head = copy_in(fifo, head, src, count);
+	SYNC_STORE_RELEASE(&fifo->head, head);
 
-		head = next_head;
-		n++;
-	}
+	return count;
+}
+
+/**
+ * Reserves a contiguous region in FIFO for writing (zero-copy write).
+ *
+ * The region starts at the current write position and is not visible to the
+ * consumer until published by fifo_commit(). Calling fifo_reserve() again
+ * before fifo_commit() returns the same region.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[out] ptr      Pointer where the region address will be stored to
+ *
+ * @return The number of elements which can be written to the region (0 if
+ * the FIFO is full). The region may be smaller than fifo_writable() if the
+ * free space wraps around the end of the buffer.
+ */
+size_t fifo_reserve(struct fifo *fifo, void **ptr)
+{
+	assert(fifo != NULL);
+	assert(ptr != NULL);
+
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head);
+	size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
+	size_t n;
+
+	if (head < tail)
+		n = tail - head - 1;
+	else if (tail == 0)
+		n = fifo->buffer_capacity - head - 1;
+	else
+		n = fifo->buffer_capacity - head;
 
-	if (n)
-		fifo->head = head;
+	*ptr = &((char *)fifo->buffer)[head * fifo->element_size];
 
 	return n;
 }
 
+/**
+ * Publishes elements written to the region obtained by fifo_reserve().
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param count         Number of elements to be published (must not exceed
+ *                      the value returned by fifo_reserve())
+ */
+void fifo_commit(struct fifo *fifo, size_t count)
+{
+	assert(fifo != NULL);
+	assert(count <= fifo_writable(fifo));
+
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head) + count;
+	if (head >= fifo->buffer_capacity)
+		head -= fifo->buffer_capacity;
+
+	SYNC_STORE_RELEASE(&fifo->head, head);
+}
+
+/**
+ * Obtains a contiguous region of FIFO for reading (zero-copy read).
+ *
+ * The elements in the region stay in the FIFO until freed by fifo_release().
+ * Calling fifo_acquire() again before fifo_release() returns the same region.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[out] ptr      Pointer where the region address will be stored to
+ *
+ * @return The number of elements which can be read from the region (0 if the
+ * FIFO is empty). The region may be smaller than fifo_readable() if the data
+ * wraps around the end of the buffer.
+ */
+size_t fifo_acquire(struct fifo *fifo, void **ptr)
+{
+	assert(fifo != NULL);
+	assert(ptr != NULL);
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n;
+
+	if (head >= tail)
+		n = head - tail;
+	else
+		n = fifo->buffer_capacity - tail;
+
+	*ptr = &((char *)fifo->buffer)[tail * fifo->element_size];
+
+	return n;
+}
+
+/**
+ * Frees elements read from the region obtained by fifo_acquire().
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param count         Number of elements to be freed (must not exceed the
+ *                      value returned by fifo_acquire())
+ */
+void fifo_release(struct fifo *fifo, size_t count)
+{
+	assert(fifo != NULL);
+	assert(count <= fifo_readable(fifo));
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail) + count;
+	if (tail >= fifo->buffer_capacity)
+		tail -= fifo->buffer_capacity;
+
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
+}
+
+/**
+ * Copies data from FIFO without removing it (non-destructive read).
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param offset        Number of elements to skip from the read position
+ * @param[out] dst      Pointer where the data will be stored to
+ * @param count         Number of elements to be copied
+ *
+ * @return The number of elements actually copied (0 to `count`)
+ */
+size_t fifo_peek(const struct fifo *fifo, size_t offset, void *dst,
+		 size_t count)
+{
+	assert(fifo != NULL);
+	assert(dst != NULL);
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n = readable(head, tail, fifo->buffer_capacity);
+
+	if (offset >= n)
+		return 0;
+
+	if (count > n - offset)
+		count = n - offset;
+
+	copy_out(fifo, advance(tail, offset, fifo->buffer_capacity), dst,
+		 count);
+
+	return count;
+}
+
+/**
+ * Removes data from FIFO without copying it.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param count         Number of elements to be removed
+ *
+ * @return The number of elements actually removed (0 to `count`)
+ */
+size_t fifo_skip(struct fifo *fifo, size_t count)
+{
+	assert(fifo != NULL);
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n = readable(head, tail, fifo->buffer_capacity);
+
+	if (count > n)
+		count = n;
+
+	if (!count)
+		return 0;
+
+	tail = advance(tail, count, fifo->buffer_capacity);
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
+
+	return count;
+}
+
+/**
+ * Finds a byte in FIFO without removing any data. This function assumes that
+ * fifo.element_size equals to one.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param offset        Number of bytes to skip from the read position
+ * @param c             Byte to be found
+ * @param[out] pos      Pointer where the byte position (relative to the read
+ *                      position) will be stored to
+ *
+ * @return `true` if the byte has been found, `false` otherwise
+ */
+bool fifo_find(const struct fifo *fifo, size_t offset, char c, size_t *pos)
+{
+	assert(fifo != NULL);
+	assert(pos != NULL);
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n = readable(head, tail, fifo->buffer_capacity);
+
+	if (offset >= n)
+		return false;
+
+	size_t i = find_byte(fifo, advance(tail, offset, fifo->buffer_capacity),
+			     n - offset, c);
+	if (i == n - offset)
+		return false;
+
+	*pos = offset + i;
+
+	return true;
+}
+
+/**
+ * Reads data from FIFO up to and including a delimiter. This function
+ * assumes that fifo.element_size equals to one.
+ *
+ * Nothing is read unless the delimiter is found within the first `count`
+ * bytes, so a parser can wait until a whole frame has been received (or drop
+ * the data with fifo_skip() if there is no delimiter in a full FIFO).
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[out] dst      Pointer where the read data will be stored to
+ * @param count         Maximum number of bytes to be read
+ * @param delim         Delimiter
+ *
+ * @return The number of bytes read including the delimiter, 0 if the
+ * delimiter has not been found
+ */
+size_t fifo_read_until(struct fifo *fifo, void *dst, size_t count, char delim)
+{
+	assert(fifo != NULL);
+	assert(dst != NULL);
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n = readable(head, tail, fifo->buffer_capacity);
+
+	if (count > n)
+		count = n;
+
+	size_t len = find_byte(fifo, tail, count, delim);
+	if (len == count)
+		return 0;
+
+	tail = copy_out(fifo, tail, dst, len + 1);
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
+
+	return len + 1;
+}
+
+/**
+ * Writes data to FIFO, overwriting the oldest elements if it is full (flight
+ * recorder mode).
+ *
+ * If `count` exceeds the FIFO capacity, only the last #fifo_capacity()
+ * elements are written.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[in] src       Pointer to the data written
+ * @param count         Number of elements to be written
+ *
+ * @return The number of elements dropped to make room for the data (including
+ * the elements of `src` which have not been written)
+ */
+size_t fifo_write_overwrite(struct fifo *fifo, const void *src, size_t count)
+{
+	assert(fifo != NULL);
+	assert(src != NULL);
+
+	size_t capacity = fifo->buffer_capacity - 1;
+	size_t dropped = 0;
+
+	if (count > capacity) {
+		dropped = count - capacity;
+		src = (const char *)src + dropped * fifo->element_size;
+		count = capacity;
+	}
+
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head);
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t n = writable(head, tail, fifo->buffer_capacity);
+
+	if (count > n) {
+		fifo_discard(fifo, count - n);
+		dropped += count - n;
+	}
+
+	head = copy_in_relaxed(fifo, head, src, count);
+	SYNC_STORE_RELEASE(&fifo->head, head);
+
+	return dropped;
+}
+
+/**
+ * Removes the oldest elements from FIFO by the producer (flight recorder
+ * mode).
+ *
+ * Unlike fifo_skip(), the elements are counted as overwritten so that a
+ * concurrent fifo_snapshot() leaves them out. Producers of variable-length
+ * records use it to drop whole records before writing a new one by
+ * fifo_write_overwrite() (which then does not drop any more elements).
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param count         Number of elements to be removed (at most
+ *                      fifo_readable())
+ */
+void fifo_discard(struct fifo *fifo, size_t count)
+{
+	assert(fifo != NULL);
+	assert(count <= fifo_readable(fifo));
+
+	size_t overwritten = SYNC_LOAD_RELAXED(&fifo->overwritten);
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+
+	/* The counter is advanced before the tail and both before the
+	 elements are overwritten, see fifo_snapshot() */
+	SYNC_STORE_RELAXED(&fifo->overwritten, overwritten + count);
+	tail = advance(tail, count, fifo->buffer_capacity);
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
+	SYNC_FENCE_RELEASE();
+}
+
+/**
+ * Copies the most recent elements from FIFO without removing them (flight
+ * recorder mode).
+ *
+ * The function does not block the producer writing by fifo_write_overwrite()
+ * (optionally preceded by fifo_discard()), elements overwritten while being
+ * copied are left out. The FIFO must not be read by any other consumer
+ * operation concurrently. Elements written by fifo_write() (or any other
+ * producer operation) may only be copied while the producer is not running,
+ * e.g. from a fault handler.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[out] dst      Pointer where the elements will be stored to
+ *                      (oldest first)
+ * @param count         Maximum number of elements to be copied (the oldest
+ *                      elements are left out if the FIFO holds more)
+ *
+ * @return The number of elements copied
+ */
+size_t fifo_snapshot(const struct fifo *fifo, void *dst, size_t count)
+{
+	assert(fifo != NULL);
+	assert(dst != NULL);
+
+	size_t overwritten, tail, head;
+
+	/* Load the indexes not modified by fifo_discard() in between: */
+	do {
+		overwritten = SYNC_LOAD_ACQUIRE(&fifo->overwritten);
+		tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
+		head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	} while (SYNC_LOAD_ACQUIRE(&fifo->overwritten) != overwritten);
+
+	size_t n = readable(head, tail, fifo->buffer_capacity);
+	size_t skip = (n > count) ? n - count : 0;
+
+	copy_out_relaxed(fifo, advance(tail, skip, fifo->buffer_capacity), dst,
+			 n - skip);
+
+	/* The oldest elements overwritten during the copy: */
+	SYNC_FENCE_ACQUIRE();
+	size_t lost = SYNC_LOAD_RELAXED(&fifo->overwritten) - overwritten;
+
+	if (lost >= n)
+		return 0;
+
+	if (lost > skip) {
+		size_t size = fifo->element_size;
+		memmove(dst, (char *)dst + (lost - skip) * size,
+			(n - lost) * size);
+		skip = lost;
+	}
+
+	return n - skip;
+}
+
 /**
  * Reads null-terminated string from FIFO. This function assumes that
  * fifo.element_size equals to one.
  *
+ * Same as fifo_ngets() without a limit on the string length, `str` must be
+ * large enough to hold the whole FIFO content.
+ *
  * @param fifo          Pointer to the #fifo structure
  * @param[out] str      Pointer where the string will be stored to
  *
  * @return Length of the string read (excluding terminating null-character)
  */
 size_t fifo_gets(struct fifo *fifo, char *str)
+{
+	return fifo_ngets(fifo, str, SIZE_MAX);
+}
+
+/**
+ * Reads null-terminated string from FIFO into a buffer of limited size.
+ * This function assumes that fifo.element_size equals to one.
+ *
+ * Characters are read up to and including the terminating null-character,
+ * or until the FIFO is empty. At most `size-1` characters are read and `str`
+ * is always null-terminated, the rest of a longer string stays in the FIFO
+ * (similar to `fgets()`).
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[out] str      Pointer where the string will be stored to
+ * @param size          Size of the `str` buffer in bytes (at least 1)
+ *
+ * @return Length of the string read (excluding terminating null-character)
+ */
+size_t fifo_ngets(struct fifo *fifo, char *str, size_t size)
 {
 	assert(fifo != NULL);
 	assert(str != NULL);
+	assert(size > 0);
 
-	size_t n = 0;
-	size_t tail = fifo->tail;
-
-	while (tail != fifo->head) {
-		str[n] = ((char *)fifo->buffer)[tail];
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n = readable(head, tail, fifo->buffer_capacity);
 
-		if (++tail == fifo->buffer_capacity)
-			tail = 0;
+	/* Look for the terminator within size characters at most: */
+	if (n > size)
+		n = size;
 
-		if (!str[n])
-			break;
+	size_t len = find_byte(fifo, tail, n, '\0');
+	size_t count = len + 1; /* Including the terminator */
 
-		n++;
+	if (len == n) { /* Terminator not found */
+		if (len == size)
+			len--;
+		count = len;
 	}
 
-	str[n] = '\0';
-	fifo->tail = tail;
+	tail = copy_out(fifo, tail, str, count);
+	str[len] = '\0';
 
-	return n;
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
+
+	return len;
 }
 
 /**
  * Writes null-terminated string to FIFO. This function assumes that
  * fifo.element_size equals to one.
  *
+ * If the string does not fit into FIFO, it is truncated to the free space
+ * (still including the terminating null-character).
+ *
  * @param fifo          Pointer to the #fifo structure
  * @param[in] str       Pointer to the string to be written
  *
@@ -261,36 +782,113 @@ size_t fifo_puts(struct fifo *fifo, const char *str)
 	assert(fifo != NULL);
 	assert(str != NULL);
 
-	size_t n = 0;
-	char *lastptr = NULL;
-	size_t head = fifo->head;
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head);
+	size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
+	size_t n = writable(head, tail, fifo->buffer_capacity);
+
+	if (!n)
+		return 0;
 
-	while (true) {
-		size_t next_head = head + 1;
-		if (next_head == fifo->buffer_capacity)
-			next_head = 0;
+	size_t len = strlen(str);
+	if (len > n - 1)
+		len = n - 1;
 
-		if (next_head == fifo->tail) { /* Fifo full */
-			if (lastptr) {
-				*lastptr = '\0';
-				n--;
-			}
-			break;
-		}
+	head = copy_in(fifo, head, str, len);
+	head = copy_in(fifo, head, "", 1);
 
-		lastptr = &((char *)fifo->buffer)[head];
-		*lastptr = str[n];
-		head = next_head;
+	SYNC_STORE_RELEASE(&fifo->head, head);
 
-		if (!str[n])
-			break;
+	return len;
+}
 
-		n++;
+/**
+ * Writes a length-prefixed string record to FIFO. This function assumes
+ * that fifo.element_size equals to one.
+ *
+ * The record consists of a `uint16_t` length (in native byte order) followed
+ * by the characters without the terminating null-character, so that
+ * fifo_read_str() copies it without scanning for the terminator. The record
+ * is written either whole or not at all. Records must not be mixed with
+ * fifo_puts() strings in the same FIFO.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[in] str       Pointer to the string to be written
+ * @param len           Length of the string (up to `UINT16_MAX`)
+ *
+ * @return `true` if the record has been written, `false` if it does not fit
+ */
+bool fifo_write_str(struct fifo *fifo, const char *str, size_t len)
+{
+	assert(fifo != NULL);
+	assert(str != NULL);
+	assert(len <= UINT16_MAX);
+
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head);
+	size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
+	uint16_t header = (uint16_t)len;
+
+	if (writable(head, tail, fifo->buffer_capacity) < sizeof(header) + len)
+		return false;
+
+	head = copy_in(fifo, head, &header, sizeof(header));
+	head = copy_in(fifo, head, str, len);
+
+	SYNC_STORE_RELEASE(&fifo->head, head);
+
+	return true;
+}
+
+/**
+ * Reads a string record written by fifo_write_str(). This function assumes
+ * that fifo.element_size equals to one.
+ *
+ * The whole record is always removed from FIFO (even if it is empty or
+ * `size` is 0). At most `size-1` characters are stored and `str` is
+ * null-terminated unless `size` is 0.
+ *
+ * @param fifo          Pointer to the #fifo structure
+ * @param[out] str      Pointer where the string will be stored to (may be
+ *                      `NULL` if `size` is 0)
+ * @param size          Size of the `str` buffer in bytes (0 to discard the
+ *                      record)
+ *
+ * @return Length of the string in the record (the string has been truncated
+ * if the value is `size` or greater), -1 if FIFO contains no record (an empty
+ * record returns 0)
+ */
+ptrdiff_t fifo_read_str(struct fifo *fifo, char *str, size_t size)
+{
+	assert(fifo != NULL);
+	assert(str != NULL || size == 0);
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+	size_t n = readable(head, tail, fifo->buffer_capacity);
+	uint16_t header;
+
+	if (size > 0)
+		str[0] = '\0';
+
+	if (n < sizeof(header))
+		return -1;
+
+	tail = copy_out(fifo, tail, &header, sizeof(header));
+	assert(n - sizeof(header) >= header);
+
+	size_t len = header;
+	size_t count = 0;
+
+	if (size > 0) {
+		count = (len < size) ? len : size - 1;
+		tail = copy_out(fifo, tail, str, count);
+		str[count] = '\0';
 	}
 
-	fifo->head = head;
+	tail = advance(tail, len - count, fifo->buffer_capacity);
 
-	return n;
+	SYNC_STORE_RELEASE(&fifo->tail, tail);
+
+	return (ptrdiff_t)len;
 }
 
 /**@}*/
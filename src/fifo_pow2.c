@@ -0,0 +1,213 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+/**
+ * @defgroup fifo_pow2_module Power-of-two FIFO
+ *
+ * FIFO (first in, first out) queue with a power-of-two capacity
+ *
+ * An alternative to the @ref fifo_module for larger or time-critical queues.
+ * It provides the same single producer/single consumer lock-free guarantees,
+ * but instead of indexes wrapped on every update it uses free-running head
+ * and tail counters which are only masked by `capacity-1` when accessing the
+ * buffer. Their difference (computed with unsigned wrap-around arithmetic,
+ * which works because the capacity divides `SIZE_MAX+1`) is the number of
+ * elements in the queue, so the empty `(head == tail)` and full
+ * `(head - tail == capacity)` states can be distinguished without sacrificing
+ * an element. The element size must be a power of two as well, so the
+ * counters are turned into buffer offsets by a shift instead of a multiply
+ * (the @ref fifo_typed_module handles elements of any size).
+ *
+ * The counters are published and loaded with release/acquire semantics (see
+ * @ref sync_defs). Just like for the @ref fifo_module, the implementation is
+ * not lock-free on architectures where loading or storing a `size_t` variable
+ * takes more than a single instruction.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <mcu-common/fifo_pow2.h>
+
+/**@{*/
+
+/**
+ * Initializes power-of-two FIFO.
+ *
+ * @param fifo Pointer to the #fifo_pow2 structure
+ *
+ * @return `true` if initialization succeeds, `false` otherwise
+ */
+bool fifo_pow2_init(struct fifo_pow2 *fifo)
+{
+	assert(fifo != NULL);
+	assert(fifo->buffer != NULL);
+	assert(fifo->element_size > 0);
+	assert((fifo->element_size & (fifo->element_size-1)) == 0);
+	assert(fifo->capacity > 0);
+	assert((fifo->capacity & (fifo->capacity-1)) == 0);
+
+	fifo->element_shift = 0;
+	while (((size_t)1 << fifo->element_shift) < fifo->element_size)
+		fifo->element_shift++;
+
+	SYNC_STORE_RELAXED(&fifo->head, 0);
+	SYNC_STORE_RELAXED(&fifo->tail, 0);
+
+	return true;
+}
+
+/**
+ * Returns number of elements the FIFO can hold.
+ *
+ * @param fifo Pointer to the #fifo_pow2 structure
+ *
+ * @return The maximum number of elements the FIFO can hold
+ */
+size_t fifo_pow2_capacity(const struct fifo_pow2 *fifo)
+{
+	assert(fifo != NULL);
+
+	return fifo->capacity;
+}
+
+/**
+ * Returns number of elements which can be read from the FIFO.
+ *
+ * @param fifo Pointer to the #fifo_pow2 structure
+ *
+ * @return The number of elements available to read (0 to
+ * #fifo_pow2_capacity())
+ */
+size_t fifo_pow2_readable(const struct fifo_pow2 *fifo)
+{
+	assert(fifo != NULL);
+
+	size_t tail = SYNC_LOAD_ACQUIRE(&fifo->tail);
+
+	return SYNC_LOAD_ACQUIRE(&fifo->head) - tail;
+}
+
+/**
+ * Returns number of elements which can be written to the FIFO.
+ *
+ * @param fifo Pointer to the #fifo_pow2 structure
+ *
+ * @return The number of elements available to write (0 to
+ * #fifo_pow2_capacity())
+ */
+size_t fifo_pow2_writable(const struct fifo_pow2 *fifo)
+{
+	assert(fifo != NULL);
+
+	size_t head = SYNC_LOAD_ACQUIRE(&fifo->head);
+
+	return fifo->capacity - (head - SYNC_LOAD_ACQUIRE(&fifo->tail));
+}
+
+/**
+ * Reads data from FIFO.
+ *
+ * @param fifo          Pointer to the #fifo_pow2 structure
+ * @param[out] dst      Pointer where the read data will be stored to
+ * @param count         Number of elements to be read
+ *
+ * @return The number of elements actually read (0 to `count`)
+ */
+size_t fifo_pow2_read(struct fifo_pow2 *fifo, void *dst, size_t count)
+{
+	assert(fifo != NULL);
+	assert(dst != NULL);
+
+	size_t tail = SYNC_LOAD_RELAXED(&fifo->tail);
+	size_t n = SYNC_LOAD_ACQUIRE(&fifo->head) - tail;
+
+	if (count > n)
+		count = n;
+
+	if (!count)
+		return 0;
+
+	unsigned int shift = fifo->element_shift;
+	size_t i = tail & (fifo->capacity-1);
+	size_t first = fifo->capacity - i;
+	if (first > count)
+		first = count;
+
+	const char *buffer = fifo->buffer;
+	memcpy(dst, &buffer[i << shift], first << shift);
+	memcpy((char *)dst + (first << shift), buffer, (count - first) << shift);
+
+	SYNC_STORE_RELEASE(&fifo->tail, tail + count);
+
+	return count;
+}
+
+/**
+ * Writes data to FIFO.
+ *
+ * @param fifo          Pointer to the #fifo_pow2 structure
+ * @param[in] src       Pointer to the data written
+ * @param count         Number of elements to be written
+ *
+ * @return The number of elements actually written (0 to `count`)
+ */
+size_t fifo_pow2_write(struct fifo_pow2 *fifo, const void *src, size_t count)
+{
+	assert(fifo != NULL);
+	assert(src != NULL);
+
+	size_t head = SYNC_LOAD_RELAXED(&fifo->head);
+	size_t n = fifo->capacity - (head - SYNC_LOAD_ACQUIRE(&fifo->tail));
+
+	if (count > n)
+		count = n;
+
+	if (!count)
+		return 0;
+
+	unsigned int shift = fifo->element_shift;
+	size_t i = head & (fifo->capacity-1);
+	size_t first = fifo->capacity - i;
+	if (first > count)
+		first = count;
+
+	char *buffer = fifo->buffer;
+	memcpy(&buffer[i << shift], src, first << shift);
+	memcpy(buffer, (const char *)src + (first << shift),
+	       (count - first) << shift);
+
+	SYNC_STORE_RELEASE(&fifo->head, head + count);
+
+	return count;
+}
+
+/**@}*/
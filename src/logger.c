@@ -32,17 +32,192 @@
 /**
  * @defgroup logger_module Logger
  * Universal logger module with deferred processing
+ *
+ * Each argument is stored with the size of its type (e.g. 8 bytes for
+ * `double`) together with a 4-bit type tag (see #logger_arg_type). The tags are
+ * computed at compile time by LOGGER_PUT() (see #LOGGER_TYPED), or derived from
+ * the conversions in the format string by logger_put(). logger_process() then
+ * passes the conversions to `snprintf` one by one, converting each argument
+ * from its stored type to the type expected by the conversion, so any
+ * combination of argument types is rendered correctly.
+ *
+ * Logger initialized by LOGGER_INIT() stores entries in a byte #fifo as
+ * variable-length records: a header byte holding the argument count and flags
+ * and a byte holding the size of the arguments followed by the format string
+ * address, an optional timestamp, the type tags (a byte per two arguments) and
+ * the arguments. A message without arguments thus takes just
+ * `2+sizeof(const char *)` bytes of the buffer.
+ * The lock-free #logger_queue (see LOGGER_INIT_LOCKFREE()) uses fixed-size
+ * slots holding the whole #logger_entry. The sharded logger (see
+ * LOGGER_INIT_SHARDED()) uses a #fifo per shard with records extended by a
+ * sequence number following the timestamp.
+ *
+ * If #LOGGER_BINARY is set, logger_process() outputs binary frames instead of
+ * formatted strings. A frame payload is the record described above (in native
+ * byte order and sizes of the stored types). It is encoded using COBS
+ * (Consistent Overhead Byte Stuffing) and terminated by a zero byte, so a
+ * decoder can always resynchronize at the next frame boundary.
  */
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include <mcu-common/logger.h>
 #include <mcu-common/critical.h>
 
+/* Variable-length record header: argument count and flags */
+#define RECORD_ARGC_MASK	0x1f
+#define RECORD_TIMESTAMP	0x20
+#define RECORD_SEQ		0x40
+#define RECORD_STRINGS		0x80
+
+#if (LOGGER_MAX_ARGC > RECORD_ARGC_MASK)
+	#error "LOGGER_MAX_ARGC does not fit the record header"
+#endif
+
+#if (LOGGER_MAX_ARGC > 16)
+	#error "LOGGER_MAX_ARGC does not fit logger_entry.types"
+#endif
+
+#if (LOGGER_ARGS_SIZE > 255)
+	#error "LOGGER_ARGS_SIZE does not fit the record header"
+#endif
+
+/* Type tag of the signed integer type of the same size as `t` */
+#define ARG_TYPE_OF(t) \
+	((sizeof(t) == sizeof(int)) ? LOGGER_ARG_INT : \
+	 (sizeof(t) == sizeof(long)) ? LOGGER_ARG_LONG : LOGGER_ARG_LLONG)
+
+/* Conversion specification parsed from a format string */
+struct conversion {
+	/* The '%' character */
+	const char *start;
+	/* End of the conversion specification */
+	const char *end;
+	/* Number of '*' (width and precision) arguments */
+	int stars;
+	/* Conversion character */
+	char conv;
+	/* Type of the argument expected by the conversion */
+	enum logger_arg_type type;
+};
+
+/* Buffer the arguments are stored to by logger_put(): Either
+ logger_entry.args or the arguments of a record */
+struct args_buf {
+	unsigned char *data;
+	size_t capacity;
+	/* Number of bytes used */
+	size_t size;
+	int argc;
+	uint64_t types;
+};
+
+/* Argument loaded from an entry */
+struct arg {
+	enum logger_arg_type type;
+	/* Value of an integer argument (sign- or zero-extended) */
+	intmax_t i;
+	/* Value of an integer argument converted to the unsigned type of its
+	 size */
+	uintmax_t u;
+	long double f;
+	const void *p;
+};
+
+/* Output of the formatter: Either a string buffer (truncated like by
+ snprintf()) or a stream of chunks passed to logger.write_cb */
+struct out {
+	/* String buffer (NULL for a stream) */
+	char *s;
+	/* Size of the string buffer */
+	size_t n;
+	/* Length of the output (even if truncated) */
+	size_t len;
+	void (*write_cb)(const char *str, size_t length);
+	/* Buffer of #STREAM_CHUNK_SIZE gathering short chunks of a stream */
+	char *chunk;
+	/* Length of the gathered chunks */
+	size_t chunk_len;
+};
+
+/* Size of the buffer for a conversion formatted by snprintf() when streaming
+ (longer conversions are truncated except for plain `%s`) */
+#define STREAM_CONV_SIZE	64
+
+/* Size of the buffer gathering short chunks of streamed messages before they
+ are passed to logger.write_cb (longer chunks are passed as they are) */
+#define STREAM_CHUNK_SIZE	64
+
+/* Format string of the message reporting dropped messages (a variable so that
+ the binary decoder can find it) */
+static const char logger_dropped_fmt[] = LOGGER_DROPPED_FMT;
+
 /**@{*/
 
-static int snprintl(char *s, size_t n, const struct logger_entry *e);
+static bool queue_init(struct logger_queue *q);
+static struct logger_entry *queue_claim(struct logger_queue *q, size_t *pos);
+static void queue_publish(struct logger_queue *q, size_t pos);
+static struct logger_entry *queue_peek(struct logger_queue *q);
+static void queue_pop(struct logger_queue *q);
+static bool entry_log(const struct logger *log, int argc, uint64_t types,
+		      const char *fmt, va_list args);
+static uint64_t types_parse(const char *fmt, int argc);
+static void entry_fill(struct logger_entry *e, int argc, uint64_t types,
+		       const char *fmt, va_list args);
+static void args_fill(struct args_buf *b, int argc, uint64_t types,
+		      va_list args);
+static bool block_wait(const struct logger *log, uint32_t start);
+static bool record_put(const struct logger *log, uint8_t *r, size_t size);
+static bool fifo_get(struct fifo *fifo, struct logger_entry *e);
+static bool fifo_drop(struct fifo *fifo);
+static bool shards_put(const struct logger *log, uint8_t *r, size_t size);
+static bool shards_get(struct logger_shards *shards, struct logger_entry *e);
+static size_t counter_add(sync_size_t *counter, size_t val);
+static void counter_max(sync_size_t *counter, size_t val);
+static void stats_update(const struct logger *log, bool written);
+static const char *conversion_next(const char *fm, struct conversion *c);
+static bool arg_store(struct args_buf *b, enum logger_arg_type type,
+		      const void *val, size_t size);
+static void entry_set_uint(struct logger_entry *e, const char *fmt,
+			   unsigned int val);
+static size_t record_size(const uint8_t *r);
+static size_t record_fill(uint8_t *r, bool seq, bool timestamped,
+			  uint32_t timestamp, int argc, uint64_t types,
+			  const char *fmt, va_list args);
+static size_t record_seq_pos(const uint8_t *r);
+static uint32_t record_seq(const uint8_t *r);
+#if LOGGER_BINARY
+static size_t record_encode(uint8_t *r, const struct logger_entry *e);
+#endif
+static void record_decode(const uint8_t *r, struct logger_entry *e);
+static bool entry_get(const struct logger *log, struct logger_entry *e);
+static void entry_output(const struct logger *log,
+			 const struct logger_entry *e);
+static bool entry_render(char *s, size_t n, const struct logger_entry *e,
+			 size_t *len);
+#if !LOGGER_BINARY
+static void entry_stream(const struct logger *log,
+			 const struct logger_entry *e);
+static void entry_format(struct out *o, const struct logger_entry *e);
+#endif
+#if LOGGER_BINARY
+static size_t frame_encode(char *s, size_t n, const struct logger_entry *e);
+#else
+static void snprintl(struct out *o, const struct logger_entry *e);
+static void arg_load(const struct logger_entry *e, int argi, size_t *pos,
+		     struct arg *a);
+static enum logger_arg_type arg_type(const struct logger_entry *e, int argi);
+static bool arg_integer(const struct arg *a);
+static void arg_narrow(struct arg *a, const char *length);
+#if LOGGER_BUILTIN_FORMAT
+static void format_conv(struct out *o, const char *spec, const struct arg *a);
+static void out_fill(struct out *o, char c, size_t count);
+#endif
+static void out_write(struct out *o, const char *data, size_t length);
+static void out_flush(struct out *o);
+#endif
 
 /**
  * Initializes logger.
@@ -55,11 +230,34 @@ bool logger_init(struct logger *log)
 {
 	assert(log != NULL);
 	assert(log->write_cb != NULL);
+	assert(log->fifo != NULL || log->queue != NULL || log->shards != NULL);
+#if LOGGER_BINARY
+	assert(log->str != NULL && log->str_size >= LOGGER_FRAME_SIZE);
+#endif
 
 	log->initialized = false;
 
-	if (!fifo_init(log->fifo))
+	if (log->stats) {
+		SYNC_STORE_RELAXED(&log->stats->enqueued, 0);
+		SYNC_STORE_RELAXED(&log->stats->dropped, 0);
+		SYNC_STORE_RELAXED(&log->stats->high_water, 0);
+		SYNC_STORE_RELAXED(&log->stats->processed, 0);
+		log->stats->reported = 0;
+	}
+
+	if (log->queue) {
+		if (!queue_init(log->queue))
+			return false;
+	} else if (log->shards) {
+		for (size_t i = 0; i < log->shards->count; i++) {
+			if (!fifo_init(&log->shards->shards[i].fifo))
+				return false;
+			log->shards->shards[i].pending = false;
+		}
+		SYNC_STORE_RELAXED(&log->shards->seq, 0);
+	} else if (!fifo_init(log->fifo)) {
 		return false;
+	}
 
 	log->initialized = true;
 	return true;
@@ -72,8 +270,21 @@ bool logger_init(struct logger *log)
  * which will be processed by `sprintf` in logger_process(). To determine the
  * number of arguments (`argc`) automatically, use macro LOGGER_PUT() instead.
  *
+ * The arguments are stored according to the conversions in the format string,
+ * so `long long`, `double` and pointer arguments are stored with full width.
+ * LOGGER_PUT() uses logger_put_typed() instead (see #LOGGER_TYPED). The strings
+ * passed to `%s` conversions must be static unless #LOGGER_STRING_COPY is set.
+ *
+ * If logger.clock_cb is set, the entry is timestamped when logger_put() is
+ * called.
+ *
  * The access to internal #fifo is protected by a critical section so
  * logger_put() can be called from multiple threads or interrupt handlers.
+ * If the logger has been initialized by LOGGER_INIT_LOCKFREE(), the entry
+ * is put to the lock-free #logger_queue without disabling interrupts instead.
+ *
+ * If the logger is full, the message is handled according to logger.overflow
+ * and counted in logger.stats.
  *
  * @param log           Pointer to the #logger structure
  * @param argc          Number of arguments (0 to #LOGGER_MAX_ARGC)
@@ -86,31 +297,60 @@ bool logger_init(struct logger *log)
  */
 bool logger_put(const struct logger *log, int argc, const char *fmt, ...)
 {
-	assert(log != NULL);
 	assert(fmt != NULL);
 	assert(argc >= 0 && argc <= LOGGER_MAX_ARGC);
 
-	if (!log->initialized)
-		return false;
+	if (argc > LOGGER_MAX_ARGC)
+		argc = LOGGER_MAX_ARGC;
 
-	struct logger_entry entry;
 	va_list args;
 
-	entry.fmt = fmt;
-	entry.argc = (argc > LOGGER_MAX_ARGC) ? LOGGER_MAX_ARGC : argc;
-
 	va_start(args, fmt);
-	for (int i = 0; i < entry.argc; i++)
-		entry.argv[i] = va_arg(args, unsigned int);
+	bool written = entry_log(log, argc, types_parse(fmt, argc), fmt, args);
 	va_end(args);
 
-	size_t n;
+	return written;
+}
 
-	CRITICAL_ENTER();
-	n = fifo_write(log->fifo, &entry, 1);
-	CRITICAL_EXIT();
+/**
+ * Logs a message with argument types given by the caller.
+ *
+ * Works as logger_put() but the arguments are stored according to `types`
+ * instead of the conversions in the format string, so the format string is
+ * not parsed. It is called by LOGGER_PUT() with the types determined at
+ * compile time (see #LOGGER_TYPED and LOGGER_ARG_TYPE()).
+ *
+ * The arguments are rendered with their actual types, e.g. an `int64_t`
+ * argument is rendered in full by `%d` and an integer argument is converted to
+ * `double` by `%f`. Therefore, unlike logger_put(), the function is not
+ * declared with the `format` attribute, LOGGER_PUT() checks the arguments by
+ * LOGGER_FORMAT_CHECK() instead.
+ *
+ * @param log           Pointer to the #logger structure
+ * @param argc          Number of arguments (0 to #LOGGER_MAX_ARGC)
+ * @param types         Types of the arguments (#logger_arg_type values in
+ *                      4 bits per argument, the first in the lowest bits)
+ * @param[in] fmt       Format string to be passed to `sprintf`
+ * @param ...           Optional arguments to be passed to `sprintf`
+ *
+ * @return `true` if the message has been logged, `false` otherwise
+ */
+bool logger_put_typed(const struct logger *log, int argc, uint64_t types,
+		      const char *fmt, ...)
+{
+	assert(fmt != NULL);
+	assert(argc >= 0 && argc <= LOGGER_MAX_ARGC);
+
+	if (argc > LOGGER_MAX_ARGC)
+		argc = LOGGER_MAX_ARGC;
+
+	va_list args;
+
+	va_start(args, fmt);
+	bool written = entry_log(log, argc, types, fmt, args);
+	va_end(args);
 
-	return (n == 1);
+	return written;
 }
 
 /**
@@ -124,62 +364,1574 @@ bool logger_put(const struct logger *log, int argc, const char *fmt, ...)
  * It is assumed this function is called from multiple threads (the internal
  * #fifo is not protected by any locking mechanism).
  *
+ * If some messages have been dropped since the last call (see
+ * logger.stats), a message with the number of dropped messages (see
+ * #LOGGER_DROPPED_FMT) is written before processing the next entry.
+ *
  * @param log Pointer to the #logger structure
  *
  * @return `true` if a message has been processed, `false` otherwise
  * (internal @ref fifo_module is empty)
  */
 bool logger_process(const struct logger *log)
+{
+	return (logger_process_batch(log, 1, 0) > 0);
+}
+
+/**
+ * Processes multiple logged messages from the buffer at once.
+ *
+ * Works as logger_process() but formats up to `max_count` messages
+ * back-to-back into the string buffer (logger.str) and passes them to
+ * logger.write_cb at once. The callback is called more than once only if the
+ * messages do not fit the string buffer, which amortizes the driver's overhead
+ * (e.g. a critical section) over many messages. Streamed messages (without
+ * logger.str) are gathered across the batch into larger chunks as well.
+ *
+ * @param log           Pointer to the #logger structure
+ * @param max_count     Maximum number of messages to be processed
+ * @param max_time      Maximum time spent by processing in logger.clock_cb
+ *                      units (`0` or no logger.clock_cb means no limit)
+ *
+ * @return Number of messages processed (`0` if the internal
+ * @ref fifo_module is empty)
+ */
+size_t logger_process_batch(const struct logger *log, size_t max_count,
+			    uint32_t max_time)
 {
 	assert(log != NULL);
 
 	if (!log->initialized)
-		return false;
+		return 0;
+
+	bool timed = (max_time > 0 && log->clock_cb);
+	uint32_t start = timed ? log->clock_cb() : 0;
+	size_t count = 0;
+	size_t len = 0;
+#if !LOGGER_BINARY
+	char chunk[STREAM_CHUNK_SIZE];
+	struct out stream = {NULL, 0, 0, log->write_cb, chunk, 0};
+#endif
+
+	while (count < max_count) {
+		if (timed && count > 0 && log->clock_cb() - start >= max_time)
+			break;
 
-	struct logger_entry entry;
-	if (fifo_read(log->fifo, &entry, 1) == 1) {
-		int n = snprintl(log->str, log->str_size, &entry);
-		if (n > 0) {
-			size_t len = (size_t)n;
-			if (len > log->str_size)
-				len = log->str_size;
+		struct logger_entry e;
+		if (!entry_get(log, &e))
+			break;
+
+#if !LOGGER_BINARY
+		if (!log->str) {
+			entry_format(&stream, &e);
+			count++;
+			continue;
+		}
+#endif
+
+		size_t n;
+		if (!entry_render(&log->str[len], log->str_size - len, &e, &n) &&
+		    len > 0) {
+			/* Flush the buffer and start over with the entry: */
 			log->write_cb(log->str, len);
+			len = 0;
+			entry_render(log->str, log->str_size, &e, &n);
 		}
-		return true;
+
+		len += n;
+		count++;
 	}
 
-	return false;
+	if (len > 0)
+		log->write_cb(log->str, len);
+#if !LOGGER_BINARY
+	out_flush(&stream);
+#endif
+
+	return count;
 }
 
-static int snprintl(char *s, size_t n, const struct logger_entry *e)
+/**
+ * Writes the logged messages out without removing them from the buffer.
+ *
+ * Meant for a logger used as a flight recorder (see
+ * #LOGGER_OVERWRITE_OLDEST) which keeps the most recent messages in RAM and
+ * writes them out only when something goes wrong. The messages are copied to
+ * `buffer` (see fifo_snapshot()), so logger_put() is neither blocked nor
+ * disturbed and the messages overwritten meanwhile are left out (with other
+ * overflow modes, logger_put() must not run concurrently). Then they are
+ * passed to logger.write_cb one by one, oldest first (merged by their
+ * sequence numbers with LOGGER_INIT_SHARDED()).
+ *
+ * It must be called from the context calling logger_process(), it is not
+ * supported by the logger initialized by LOGGER_INIT_LOCKFREE().
+ *
+ * @param log           Pointer to the #logger structure
+ * @param[out] buffer   Pointer to a buffer for the copy of the messages
+ * @param size          Size of the buffer in bytes (at least
+ *                      LOGGER_SNAPSHOT_SIZE())
+ *
+ * @return Number of messages written
+ */
+size_t logger_snapshot(const struct logger *log, void *buffer, size_t size)
 {
-	assert(s != NULL);
-	assert(e != NULL);
+	assert(log != NULL);
+	assert(buffer != NULL);
+	assert(log->queue == NULL);
 
-	const char *fm = e->fmt;
-	const unsigned int *a = e->argv;
-
-	switch (e->argc) {
-	case 0:
-		return snprintf(s, n, fm);
-	case 1:
-		return snprintf(s, n, fm, a[0]);
-	case 2:
-		return snprintf(s, n, fm, a[0], a[1]);
-	case 3:
-		return snprintf(s, n, fm, a[0], a[1], a[2]);
-	case 4:
-		return snprintf(s, n, fm, a[0], a[1], a[2], a[3]);
-	case 5:
-		return snprintf(s, n, fm, a[0], a[1], a[2], a[3], a[4]);
-	case 6:
-		return snprintf(s, n, fm, a[0], a[1], a[2], a[3], a[4], a[5]);
-#if (LOGGER_MAX_ARGC > 6)
-	#error "Please define more cases for the given value of LOGGER_MAX_ARGC"
+	if (!log->initialized || log->queue)
+		return 0;
+
+	uint8_t *r = buffer;
+	size_t count = 0;
+	struct logger_entry e;
+
+	if (!log->shards) {
+		assert(size >= fifo_capacity(log->fifo));
+
+		size_t len = fifo_snapshot(log->fifo, r, size);
+		for (size_t pos = 0; pos < len; pos += record_size(&r[pos])) {
+			record_decode(&r[pos], &e);
+			entry_output(log, &e);
+			count++;
+		}
+
+		return count;
+	}
+
+	struct logger_shards *shards = log->shards;
+
+	/* The snapshot of each shard starts with a whole record as the
+	 producer only drops whole records: */
+	for (size_t i = 0; i < shards->count; i++) {
+		struct logger_shard *shard = &shards->shards[i];
+		size_t capacity = fifo_capacity(&shard->fifo);
+		assert(size >= capacity);
+
+		shard->snapshot = r;
+		shard->snapshot_size = fifo_snapshot(&shard->fifo, r, capacity);
+		r += capacity;
+		size -= capacity;
+	}
+
+	while (true) {
+		struct logger_shard *oldest = NULL;
+		uint32_t oldest_seq = 0;
+
+		for (size_t i = 0; i < shards->count; i++) {
+			struct logger_shard *shard = &shards->shards[i];
+			if (!shard->snapshot_size)
+				continue;
+
+			/* The sequence numbers may wrap around: */
+			uint32_t seq = record_seq(shard->snapshot);
+			if (!oldest || (int32_t)(seq - oldest_seq) < 0) {
+				oldest = shard;
+				oldest_seq = seq;
+			}
+		}
+
+		if (!oldest)
+			break;
+
+		size_t n = record_size(oldest->snapshot);
+		record_decode(oldest->snapshot, &e);
+		oldest->snapshot += n;
+		oldest->snapshot_size -= n;
+
+		entry_output(log, &e);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * The lock-free queue is a bounded multi-producer queue where each slot holds
+ * a sequence number: The slot at position `pos` is free for a producer if
+ * `seq == pos`, it holds a published entry if `seq == pos+1` and it is freed
+ * for the next lap by the consumer by setting `seq = pos+capacity`.
+ * Producers claim positions by advancing the head with compare-and-swap, so
+ * a producer interrupted between claiming and publishing its slot only delays
+ * the consumer (which stops at the unpublished slot) but never blocks other
+ * producers.
+ */
+static bool queue_init(struct logger_queue *q)
+{
+	assert(q->slots != NULL);
+	assert(q->capacity > 0);
+	assert((q->capacity & (q->capacity-1)) == 0);
+
+	for (size_t i = 0; i < q->capacity; i++)
+		SYNC_STORE_RELAXED(&q->slots[i].seq, i);
+
+	SYNC_STORE_RELAXED(&q->head, 0);
+	q->tail = 0;
+
+	return true;
+}
+
+static struct logger_entry *queue_claim(struct logger_queue *q, size_t *pos)
+{
+	struct logger_slot *slot;
+
+#ifdef SYNC_HAS_CAS
+	size_t p = SYNC_LOAD_RELAXED(&q->head);
+
+	while (true) {
+		slot = &q->slots[p & (q->capacity-1)];
+		size_t seq = SYNC_LOAD_ACQUIRE(&slot->seq);
+
+		if (seq == p) {
+			if (SYNC_CAS(&q->head, &p, p+1))
+				break;
+		} else if ((ptrdiff_t)(seq - p) < 0) {
+			return NULL; /* Queue full */
+		} else {
+			p = SYNC_LOAD_RELAXED(&q->head);
+		}
+	}
+#else
+	size_t p;
+
+	CRITICAL_ENTER();
+
+	p = SYNC_LOAD_RELAXED(&q->head);
+	slot = &q->slots[p & (q->capacity-1)];
+
+	if (SYNC_LOAD_ACQUIRE(&slot->seq) == p)
+		SYNC_STORE_RELAXED(&q->head, p+1);
+	else
+		slot = NULL; /* Queue full */
+
+	CRITICAL_EXIT();
+
+	if (!slot)
+		return NULL;
+#endif
+
+	*pos = p;
+	return &slot->entry;
+}
+
+static void queue_publish(struct logger_queue *q, size_t pos)
+{
+	struct logger_slot *slot = &q->slots[pos & (q->capacity-1)];
+	SYNC_STORE_RELEASE(&slot->seq, pos+1);
+}
+
+static struct logger_entry *queue_peek(struct logger_queue *q)
+{
+	struct logger_slot *slot = &q->slots[q->tail & (q->capacity-1)];
+
+	if (SYNC_LOAD_ACQUIRE(&slot->seq) != q->tail+1)
+		return NULL; /* Queue empty or slot not published yet */
+
+	return &slot->entry;
+}
+
+static void queue_pop(struct logger_queue *q)
+{
+	struct logger_slot *slot = &q->slots[q->tail & (q->capacity-1)];
+
+	SYNC_STORE_RELEASE(&slot->seq, q->tail + q->capacity);
+	q->tail++;
+}
+
+static bool entry_log(const struct logger *log, int argc, uint64_t types,
+		      const char *fmt, va_list args)
+{
+	assert(log != NULL);
+
+	if (!log->initialized)
+		return false;
+
+	/* Capture the timestamp as soon as possible: */
+	bool timestamped = (log->clock_cb != NULL);
+	uint32_t timestamp = timestamped ? log->clock_cb() : 0;
+	bool written;
+
+	if (log->queue) {
+		/* The entry is filled in the claimed slot: */
+		size_t pos;
+		struct logger_entry *e = queue_claim(log->queue, &pos);
+
+		if (!e && log->overflow == LOGGER_BLOCK) {
+			uint32_t start = log->clock_cb ? log->clock_cb() : 0;
+
+			do {
+				e = queue_claim(log->queue, &pos);
+			} while (!e && block_wait(log, start));
+		}
+
+		written = (e != NULL);
+
+		if (e) {
+			e->timestamped = timestamped;
+			e->timestamp = timestamp;
+			entry_fill(e, argc, types, fmt, args);
+			queue_publish(log->queue, pos);
+		}
+	} else {
+		/* The record is encoded straight from the arguments: */
+		uint8_t record[LOGGER_RECORD_MAX_SIZE];
+		size_t size = record_fill(record, (log->shards != NULL),
+					  timestamped, timestamp, argc, types,
+					  fmt, args);
+
+		written = record_put(log, record, size);
+
+		if (!written && log->overflow == LOGGER_BLOCK) {
+			/* Wait for logger_process() to free some space: */
+			uint32_t start = log->clock_cb ? log->clock_cb() : 0;
+
+			do {
+				written = record_put(log, record, size);
+			} while (!written && block_wait(log, start));
+		}
+	}
+
+	if (log->stats)
+		stats_update(log, written);
+
+	return written;
+}
+
+/* Returns whether a blocked logger_put() started at `start` should keep
+ waiting */
+static bool block_wait(const struct logger *log, uint32_t start)
+{
+	return !log->clock_cb || log->block_timeout == 0 ||
+	       log->clock_cb() - start < log->block_timeout;
+}
+
+/* Derives the types of `argc` arguments from the conversions in the format
+ string */
+static uint64_t types_parse(const char *fmt, int argc)
+{
+	struct conversion c;
+	uint64_t types = 0;
+	int argi = 0;
+
+	while (argi < argc && (fmt = conversion_next(fmt, &c)) != NULL) {
+		for (int i = 0; i < c.stars && argi < argc; i++)
+			types |= (uint64_t)LOGGER_ARG_INT << (4*argi++);
+
+		if (c.type != LOGGER_ARG_NONE && argi < argc)
+			types |= (uint64_t)c.type << (4*argi++);
+	}
+
+	return types;
+}
+
+static void entry_fill(struct logger_entry *e, int argc, uint64_t types,
+		       const char *fmt, va_list args)
+{
+	struct args_buf b = {e->args, sizeof(e->args), 0, 0, 0};
+
+	args_fill(&b, argc, types, args);
+
+	e->fmt = fmt;
+	e->argc = b.argc;
+	e->size = b.size;
+	e->types = b.types;
+}
+
+/* Stores the arguments to the buffer until one of them does not fit */
+static void args_fill(struct args_buf *b, int argc, uint64_t types,
+		      va_list args)
+{
+	for (int i = 0; i < argc; i++) {
+		enum logger_arg_type type =
+			(enum logger_arg_type)((types >> (4*i)) & 0xf);
+		bool stored = false;
+
+		switch (type) {
+		case LOGGER_ARG_NONE:
+			break;
+		case LOGGER_ARG_INT:
+		case LOGGER_ARG_UINT: {
+			unsigned int val = va_arg(args, unsigned int);
+			stored = arg_store(b, type, &val, sizeof(val));
+			break;
+		}
+		case LOGGER_ARG_LONG:
+		case LOGGER_ARG_ULONG: {
+			unsigned long val = va_arg(args, unsigned long);
+			stored = arg_store(b, type, &val, sizeof(val));
+			break;
+		}
+		case LOGGER_ARG_LLONG:
+		case LOGGER_ARG_ULLONG: {
+			unsigned long long val = va_arg(args, unsigned long long);
+			stored = arg_store(b, type, &val, sizeof(val));
+			break;
+		}
+		case LOGGER_ARG_DOUBLE: {
+			double val = va_arg(args, double);
+			stored = arg_store(b, type, &val, sizeof(val));
+			break;
+		}
+		case LOGGER_ARG_LDOUBLE: {
+			long double val = va_arg(args, long double);
+			stored = arg_store(b, type, &val, sizeof(val));
+			break;
+		}
+		case LOGGER_ARG_PTR: {
+			const void *val = va_arg(args, const void *);
+			stored = arg_store(b, type, &val, sizeof(val));
+			break;
+		}
+		case LOGGER_ARG_STR: {
+			const char *val = va_arg(args, const char *);
+#if LOGGER_STRING_COPY
+			if (!val)
+				val = "(null)";
+
+			/* Copy (and truncate) the string including the null
+			 character: */
+			size_t len = 0;
+			while (len < LOGGER_STRING_COPY-1 && val[len] != '\0')
+				len++;
+
+			if (b->size + len + 1 > b->capacity)
+				return;
+
+			memcpy(&b->data[b->size], val, len);
+			b->data[b->size + len] = '\0';
+			b->size += len + 1;
+			b->types |= (uint64_t)type << (4*b->argc);
+			b->argc++;
+			stored = true;
+#else
+			stored = arg_store(b, type, &val, sizeof(val));
 #endif
+			break;
+		}
+		}
+
+		/* Unknown type or the rest of the message does not fit: */
+		if (!stored)
+			return;
+	}
+}
+
+/* Appends an argument value to the buffer (if it fits) */
+static bool arg_store(struct args_buf *b, enum logger_arg_type type,
+		      const void *val, size_t size)
+{
+	if (b->size + size > b->capacity)
+		return false;
+
+	memcpy(&b->data[b->size], val, size);
+	b->size += size;
+	b->types |= (uint64_t)type << (4*b->argc);
+	b->argc++;
+
+	return true;
+}
+
+/* Sets the entry to a message with a single unsigned argument (used by the
+ consumer to report dropped messages and render timestamps) */
+static void entry_set_uint(struct logger_entry *e, const char *fmt,
+			   unsigned int val)
+{
+	struct args_buf b = {e->args, sizeof(e->args), 0, 0, 0};
+
+	arg_store(&b, LOGGER_ARG_UINT, &val, sizeof(val));
+
+	e->fmt = fmt;
+	e->argc = b.argc;
+	e->size = b.size;
+	e->types = b.types;
+	e->timestamped = false;
+}
+
+/*
+ * Finds the next conversion specification in the format string, returns the
+ * position following it or NULL if there is none.
+ */
+static const char *conversion_next(const char *fm, struct conversion *c)
+{
+	while (*fm != '%') {
+		if (*fm == '\0')
+			return NULL;
+		fm++;
+	}
+
+	c->start = fm++;
+	c->stars = 0;
+	c->type = LOGGER_ARG_NONE;
+
+	/* Flags, width and precision: */
+	while (*fm != '\0' && strchr("-+ #0", *fm))
+		fm++;
+
+	for (int i = 0; i < 2; i++) {
+		if (i == 1) {
+			if (*fm != '.')
+				break;
+			fm++;
+		}
+
+		if (*fm == '*') {
+			c->stars++;
+			fm++;
+		} else {
+			while (*fm >= '0' && *fm <= '9')
+				fm++;
+		}
+	}
+
+	/* Length modifier (as the signed integer type): */
+	enum logger_arg_type length = LOGGER_ARG_INT;
+	bool ldouble = false;
+
+	switch (*fm) {
+	case 'h':
+		fm += (fm[1] == 'h') ? 2 : 1;
+		break;
+	case 'l':
+		if (fm[1] == 'l') {
+			length = LOGGER_ARG_LLONG;
+			fm += 2;
+		} else {
+			length = LOGGER_ARG_LONG;
+			fm++;
+		}
+		break;
+	case 'j':
+		length = ARG_TYPE_OF(intmax_t);
+		fm++;
+		break;
+	case 'z':
+		length = ARG_TYPE_OF(size_t);
+		fm++;
+		break;
+	case 't':
+		length = ARG_TYPE_OF(ptrdiff_t);
+		fm++;
+		break;
+	case 'L':
+		ldouble = true;
+		fm++;
+		break;
+	}
+
+	c->conv = *fm;
+	if (*fm != '\0')
+		fm++;
+	c->end = fm;
+
+	switch (c->conv) {
+	case 'd': case 'i':
+		c->type = length;
+		break;
+	case 'o': case 'u': case 'x': case 'X':
+		/* The unsigned types follow the signed ones: */
+		c->type = length + 1;
+		break;
+	case 'c':
+		c->type = LOGGER_ARG_INT;
+		break;
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		c->type = ldouble ? LOGGER_ARG_LDOUBLE : LOGGER_ARG_DOUBLE;
+		break;
+	case 's':
+		c->type = (length == LOGGER_ARG_LONG) ? LOGGER_ARG_PTR :
+			  LOGGER_ARG_STR;
+		break;
+	case 'p':
+		c->type = LOGGER_ARG_PTR;
+		break;
 	default:
-		return -1;
+		/* `%%` or an unsupported conversion (e.g. `%n`): */
+		c->stars = 0;
+		break;
+	}
+
+	return fm;
+}
+
+/* Writes the record (encoded before entering the critical section) */
+static bool record_put(const struct logger *log, uint8_t *r, size_t size)
+{
+	if (log->shards)
+		return shards_put(log, r, size);
+
+	bool written = false;
+
+	CRITICAL_ENTER();
+
+	if (log->overflow == LOGGER_OVERWRITE_OLDEST) {
+		/* The consumer also accesses the FIFO in a critical section */
+		while (fifo_writable(log->fifo) < size &&
+		       fifo_drop(log->fifo)) {
+			if (log->stats)
+				counter_add(&log->stats->dropped, 1);
+		}
+	}
+
+	if (fifo_writable(log->fifo) >= size) {
+		/* Written so that logger_snapshot() can copy the FIFO
+		 concurrently (see fifo_snapshot()): */
+		if (log->overflow == LOGGER_OVERWRITE_OLDEST)
+			fifo_write_overwrite(log->fifo, r, size);
+		else
+			fifo_write(log->fifo, r, size);
+		written = true;
 	}
+
+	CRITICAL_EXIT();
+
+	return written;
+}
+
+/* Reads a single record from FIFO */
+static bool fifo_get(struct fifo *fifo, struct logger_entry *e)
+{
+	/* The first two bytes determine the record size: */
+	uint8_t record[LOGGER_RECORD_MAX_SIZE];
+	if (fifo_read(fifo, record, 2) < 2)
+		return false;
+
+	/* The whole record has been published at once: */
+	size_t size = record_size(record);
+	fifo_read(fifo, &record[2], size - 2);
+	record_decode(record, e);
+
+	return true;
 }
 
+/* Drops the oldest record from FIFO by the producer (see fifo_discard()) */
+static bool fifo_drop(struct fifo *fifo)
+{
+	uint8_t header[2];
+	if (fifo_peek(fifo, 0, header, sizeof(header)) < sizeof(header))
+		return false;
+
+	fifo_discard(fifo, record_size(header));
+
+	return true;
+}
+
+/*
+ * Puts the record (holding a sequence number) to the shard of the calling
+ * context. The shard's FIFO is only written by a single context at a time,
+ * no locking is needed.
+ */
+static bool shards_put(const struct logger *log, uint8_t *r, size_t size)
+{
+	unsigned int index = log->shard_cb ? log->shard_cb() : 0;
+	assert(index < log->shards->count);
+
+	struct fifo *fifo = &log->shards->shards[index].fifo;
+
+	uint32_t seq = (uint32_t)counter_add(&log->shards->seq, 1);
+	memcpy(&r[record_seq_pos(r)], &seq, sizeof(seq));
+
+	/* The shard's producer owns the whole FIFO in this mode: */
+	if (log->overflow == LOGGER_OVERWRITE_OLDEST) {
+		while (fifo_writable(fifo) < size && fifo_drop(fifo)) {
+			if (log->stats)
+				counter_add(&log->stats->dropped, 1);
+		}
+	}
+
+	if (fifo_writable(fifo) < size)
+		return false;
+
+	if (log->overflow == LOGGER_OVERWRITE_OLDEST)
+		fifo_write_overwrite(fifo, r, size);
+	else
+		fifo_write(fifo, r, size);
+
+	return true;
+}
+
+/* Takes the entry with the lowest sequence number from all shards */
+static bool shards_get(struct logger_shards *shards, struct logger_entry *e)
+{
+	struct logger_shard *oldest = NULL;
+
+	for (size_t i = 0; i < shards->count; i++) {
+		struct logger_shard *shard = &shards->shards[i];
+
+		if (!shard->pending)
+			shard->pending = fifo_get(&shard->fifo, &shard->head);
+
+		/* The sequence numbers may wrap around: */
+		if (shard->pending && (!oldest ||
+		    (int32_t)(shard->head.seq - oldest->head.seq) < 0))
+			oldest = shard;
+	}
+
+	if (!oldest)
+		return false;
+
+	*e = oldest->head;
+	oldest->pending = false;
+
+	return true;
+}
+
+/*
+ * The counters may be updated by multiple producers at once (lock-free queue),
+ * so they are updated atomically. Returns the previous value.
+ */
+static size_t counter_add(sync_size_t *counter, size_t val)
+{
+#ifdef SYNC_HAS_CAS
+	size_t old = SYNC_LOAD_RELAXED(counter);
+	while (!SYNC_CAS(counter, &old, old + val));
+#else
+	size_t old;
+
+	CRITICAL_ENTER();
+	old = SYNC_LOAD_RELAXED(counter);
+	SYNC_STORE_RELAXED(counter, old + val);
+	CRITICAL_EXIT();
+#endif
+
+	return old;
+}
+
+static void counter_max(sync_size_t *counter, size_t val)
+{
+#ifdef SYNC_HAS_CAS
+	size_t old = SYNC_LOAD_RELAXED(counter);
+	while (old < val && !SYNC_CAS(counter, &old, val));
+#else
+	CRITICAL_ENTER();
+	if (SYNC_LOAD_RELAXED(counter) < val)
+		SYNC_STORE_RELAXED(counter, val);
+	CRITICAL_EXIT();
+#endif
+}
+
+static void stats_update(const struct logger *log, bool written)
+{
+	struct logger_stats *stats = log->stats;
+
+	if (!written) {
+		counter_add(&stats->dropped, 1);
+		return;
+	}
+
+	counter_add(&stats->enqueued, 1);
+
+	/* Number of pending entries (approximate, entries overwritten by
+	 logger_put() are counted as processed): */
+	size_t pending = SYNC_LOAD_RELAXED(&stats->enqueued) -
+			 SYNC_LOAD_RELAXED(&stats->processed);
+	if (log->overflow == LOGGER_OVERWRITE_OLDEST)
+		pending -= SYNC_LOAD_RELAXED(&stats->dropped);
+
+	counter_max(&stats->high_water, pending);
+}
+
+static size_t record_size(const uint8_t *r)
+{
+	size_t size = 2 + sizeof(const char *);
+
+	if (r[0] & RECORD_TIMESTAMP)
+		size += sizeof(uint32_t);
+	if (r[0] & RECORD_SEQ)
+		size += sizeof(uint32_t);
+
+	/* Argument types: */
+	size += ((r[0] & RECORD_ARGC_MASK) + 1) / 2;
+
+	return size + r[1];
+}
+
+#if LOGGER_BINARY
+/* Encodes the entry (without a sequence number) to a frame payload */
+static size_t record_encode(uint8_t *r, const struct logger_entry *e)
+{
+	size_t len = 0;
+
+	r[len++] = (uint8_t)e->argc | (e->timestamped ? RECORD_TIMESTAMP : 0) |
+		   (LOGGER_STRING_COPY ? RECORD_STRINGS : 0);
+	r[len++] = (uint8_t)e->size;
+	memcpy(&r[len], &e->fmt, sizeof(e->fmt));
+	len += sizeof(e->fmt);
+
+	if (e->timestamped) {
+		memcpy(&r[len], &e->timestamp, sizeof(e->timestamp));
+		len += sizeof(e->timestamp);
+	}
+
+	for (int i = 0; i < e->argc; i += 2)
+		r[len++] = (uint8_t)(e->types >> (4*i));
+
+	memcpy(&r[len], e->args, e->size);
+	len += e->size;
+
+	return len;
+}
+#endif
+
+/*
+ * Encodes the record directly from the arguments, so that logger_put() does
+ * not need a whole #logger_entry on stack. The sequence number is only
+ * reserved (see shards_put()). Returns the size of the record.
+ */
+static size_t record_fill(uint8_t *r, bool seq, bool timestamped,
+			  uint32_t timestamp, int argc, uint64_t types,
+			  const char *fmt, va_list args)
+{
+	size_t len = 2;
+
+	memcpy(&r[len], &fmt, sizeof(fmt));
+	len += sizeof(fmt);
+
+	if (timestamped) {
+		memcpy(&r[len], &timestamp, sizeof(timestamp));
+		len += sizeof(timestamp);
+	}
+
+	if (seq)
+		len += sizeof(uint32_t);
+
+	/* Reserve the argument types for all the arguments: */
+	size_t types_pos = len;
+	len += (argc+1) / 2;
+
+	struct args_buf b = {&r[len], LOGGER_ARGS_SIZE, 0, 0, 0};
+	args_fill(&b, argc, types, args);
+
+	/* Move the arguments if some of them have not been stored: */
+	size_t args_pos = types_pos + (b.argc+1) / 2;
+	if (args_pos < len)
+		memmove(&r[args_pos], &r[len], b.size);
+
+	for (int i = 0; i < b.argc; i += 2)
+		r[types_pos++] = (uint8_t)(b.types >> (4*i));
+
+	r[0] = (uint8_t)b.argc | (timestamped ? RECORD_TIMESTAMP : 0) |
+	       (seq ? RECORD_SEQ : 0) |
+	       (LOGGER_STRING_COPY ? RECORD_STRINGS : 0);
+	r[1] = (uint8_t)b.size;
+
+	return args_pos + b.size;
+}
+
+/* Position of the sequence number in a record holding one */
+static size_t record_seq_pos(const uint8_t *r)
+{
+	size_t len = 2 + sizeof(const char *);
+
+	if (r[0] & RECORD_TIMESTAMP)
+		len += sizeof(uint32_t);
+
+	return len;
+}
+
+/* Sequence number of a record holding one (see record_fill()) */
+static uint32_t record_seq(const uint8_t *r)
+{
+	uint32_t seq;
+
+	memcpy(&seq, &r[record_seq_pos(r)], sizeof(seq));
+
+	return seq;
+}
+
+static void record_decode(const uint8_t *r, struct logger_entry *e)
+{
+	size_t len = 2;
+
+	e->argc = r[0] & RECORD_ARGC_MASK;
+	e->size = r[1];
+	e->timestamped = (r[0] & RECORD_TIMESTAMP) != 0;
+	memcpy(&e->fmt, &r[len], sizeof(e->fmt));
+	len += sizeof(e->fmt);
+
+	if (e->timestamped) {
+		memcpy(&e->timestamp, &r[len], sizeof(e->timestamp));
+		len += sizeof(e->timestamp);
+	}
+
+	if (r[0] & RECORD_SEQ) {
+		memcpy(&e->seq, &r[len], sizeof(e->seq));
+		len += sizeof(e->seq);
+	}
+
+	e->types = 0;
+	for (int i = 0; i < e->argc; i += 2)
+		e->types |= (uint64_t)r[len++] << (4*i);
+
+	memcpy(e->args, &r[len], e->size);
+}
+
+/*
+ * Takes the next entry to be processed: Either a report of dropped messages
+ * or the oldest logged entry.
+ */
+static bool entry_get(const struct logger *log, struct logger_entry *e)
+{
+	if (log->stats) {
+		size_t dropped = SYNC_LOAD_RELAXED(&log->stats->dropped);
+		size_t count = dropped - log->stats->reported;
+
+		if (count > 0) {
+			log->stats->reported = dropped;
+
+			entry_set_uint(e, logger_dropped_fmt,
+				       (unsigned int)count);
+
+			return true;
+		}
+	}
+
+	if (log->shards) {
+		if (!shards_get(log->shards, e))
+			return false;
+	} else if (log->queue) {
+		struct logger_entry *entry = queue_peek(log->queue);
+		if (!entry)
+			return false;
+
+		*e = *entry;
+		queue_pop(log->queue);
+	} else {
+		bool read;
+
+		/* The oldest records may be dropped by logger_put(): */
+		if (log->overflow == LOGGER_OVERWRITE_OLDEST) {
+			CRITICAL_ENTER();
+			read = fifo_get(log->fifo, e);
+			CRITICAL_EXIT();
+		} else {
+			read = fifo_get(log->fifo, e);
+		}
+
+		if (!read)
+			return false;
+	}
+
+	if (log->stats) {
+		size_t processed = SYNC_LOAD_RELAXED(&log->stats->processed);
+		SYNC_STORE_RELAXED(&log->stats->processed, processed + 1);
+	}
+
+	return true;
+}
+
+/* Writes a single entry out by logger.write_cb */
+static void entry_output(const struct logger *log,
+			 const struct logger_entry *e)
+{
+#if !LOGGER_BINARY
+	if (!log->str) {
+		entry_stream(log, e);
+		return;
+	}
+#endif
+
+	size_t n;
+	entry_render(log->str, log->str_size, e, &n);
+	log->write_cb(log->str, n);
+}
+
+/*
+ * Renders the entry to the string buffer, returns `false` if it has been
+ * truncated (a binary frame which does not fit is not rendered at all)
+ */
+static bool entry_render(char *s, size_t n, const struct logger_entry *e,
+			 size_t *len)
+{
+#if LOGGER_BINARY
+	*len = frame_encode(s, n, e);
+	return (*len > 0);
+#else
+	struct out o = {s, n, 0, NULL, NULL, 0};
+
+	entry_format(&o, e);
+	*len = o.len;
+
+	/* The output has been truncated to fit the buffer: */
+	if (*len >= n) {
+		*len = n-1;
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+#if !LOGGER_BINARY
+
+/* Renders the entry in chunks passed to logger.write_cb */
+static void entry_stream(const struct logger *log,
+			 const struct logger_entry *e)
+{
+	char chunk[STREAM_CHUNK_SIZE];
+	struct out o = {NULL, 0, 0, log->write_cb, chunk, 0};
+
+	entry_format(&o, e);
+	out_flush(&o);
+}
+
+/* Formats the entry including the timestamp */
+static void entry_format(struct out *o, const struct logger_entry *e)
+{
+	if (e->timestamped) {
+		/* The timestamp is rendered as an entry as well: */
+		struct logger_entry ts;
+		entry_set_uint(&ts, LOGGER_TIMESTAMP_FMT, e->timestamp);
+
+		snprintl(o, &ts);
+	}
+
+	snprintl(o, e);
+}
+
+#endif
+
+#if LOGGER_BINARY
+
+static size_t frame_encode(char *s, size_t n, const struct logger_entry *e)
+{
+	assert(s != NULL);
+	assert(e != NULL);
+
+	uint8_t payload[LOGGER_PAYLOAD_SIZE];
+	size_t len = record_encode(payload, e);
+
+	if (n < len + len/254 + 2)
+		return 0;
+
+	/* COBS: Each zero byte is replaced by the offset to the next one, the
+	 offsets are limited to 255 by inserting extra code bytes */
+	size_t code_idx = 0;
+	size_t out = 1;
+	uint8_t code = 1;
+
+	for (size_t i = 0; i < len; i++) {
+		if (payload[i] != 0) {
+			s[out++] = (char)payload[i];
+			code++;
+		}
+
+		if (payload[i] == 0 || code == 0xff) {
+			s[code_idx] = (char)code;
+			code_idx = out++;
+			code = 1;
+		}
+	}
+
+	s[code_idx] = (char)code;
+	s[out++] = '\0'; /* Frame delimiter */
+
+	return out;
+}
+
+#else
+
+/*
+ * Formats the entry like snprintf(). Each conversion is passed to snprintf()
+ * separately together with its argument converted to the type expected by the
+ * conversion, so the arguments can have any type and their number is not
+ * limited.
+ */
+static void snprintl(struct out *o, const struct logger_entry *e)
+{
+	assert(o != NULL);
+	assert(e != NULL);
+
+	const char *fm = e->fmt;
+	const char *next;
+	struct conversion c;
+	struct arg a;
+	size_t pos = 0;
+	int argi = 0;
+
+	while ((next = conversion_next(fm, &c)) != NULL) {
+		bool fits = true;
+
+		out_write(o, fm, (size_t)(c.start - fm));
+		fm = next;
+
+		if (c.type == LOGGER_ARG_NONE) {
+			if (c.conv == '%')
+				out_write(o, "%", 1);
+			else
+				out_write(o, c.start, (size_t)(c.end - c.start));
+			continue;
+		}
+
+		/* The arguments have not been stored, the rest of the message
+		 is written with placeholders: */
+		if (argi + c.stars >= e->argc) {
+			argi = e->argc;
+			out_write(o, "?", 1);
+			continue;
+		}
+
+		/* Compose the specification with '*' replaced by values and
+		 the length modifier replaced by the one of the passed type: */
+		char spec[32];
+		size_t sl = 0;
+		const char *length = c.end - 1;
+
+		for (const char *p = c.start; p < c.end - 1; p++) {
+			if (sl >= sizeof(spec) - 14)
+				fits = false;
+
+			if (*p == '*') {
+				arg_load(e, argi++, &pos, &a);
+				if (!arg_integer(&a))
+					a.i = (intmax_t)a.f;
+				if (!fits)
+					continue;
+
+				/* Negative precision is ignored: */
+				if (sl > 0 && spec[sl-1] == '.' && a.i < 0) {
+					sl--;
+					continue;
+				}
+#if LOGGER_BUILTIN_FORMAT
+				struct out so = {&spec[sl], sizeof(spec) - sl,
+						 0, NULL, NULL, 0};
+				format_conv(&so, "%d", &a);
+				sl += so.len;
+#else
+				sl += (size_t)sprintf(&spec[sl], "%d", (int)a.i);
+#endif
+			} else if (strchr("hljztL", *p)) {
+				if (length > p)
+					length = p;
+			} else if (fits) {
+				spec[sl++] = *p;
+			}
+		}
+
+		arg_load(e, argi++, &pos, &a);
+		arg_narrow(&a, length);
+
+		/* The specification is too long: */
+		if (!fits) {
+			out_write(o, "?", 1);
+			continue;
+		}
+
+#if LOGGER_BUILTIN_FORMAT
+		spec[sl++] = c.conv;
+		spec[sl] = '\0';
+		format_conv(o, spec, &a);
+#else
+		bool integer = arg_integer(&a);
+
+		/* Plain strings are streamed without copying: */
+		if (!o->s && c.conv == 's' && sl == 1 && length == c.end - 1) {
+			const char *str = integer ? "(invalid)" :
+					  a.p ? (const char *)a.p : "(null)";
+			out_write(o, str, strlen(str));
+			continue;
+		}
+
+		/* The conversion is formatted in place or to a buffer to be
+		 streamed: */
+		char conv[STREAM_CONV_SIZE];
+		char *dst = o->s ? ((o->len < o->n) ? &o->s[o->len] : NULL) :
+			    conv;
+		size_t room = o->s ? ((o->len < o->n) ? o->n - o->len : 0) :
+			      sizeof(conv);
+		int ret = 0;
+
+		switch (c.conv) {
+		case 'd': case 'i':
+			spec[sl++] = 'j';
+			spec[sl++] = c.conv;
+			spec[sl] = '\0';
+			ret = snprintf(dst, room, spec, integer ? a.i :
+				       (intmax_t)a.f);
+			break;
+		case 'o': case 'u': case 'x': case 'X':
+			spec[sl++] = 'j';
+			spec[sl++] = c.conv;
+			spec[sl] = '\0';
+			ret = snprintf(dst, room, spec, integer ? a.u :
+				       (uintmax_t)a.f);
+			break;
+		case 'c':
+			memcpy(&spec[sl], length, (size_t)(c.end - length));
+			spec[sl + (size_t)(c.end - length)] = '\0';
+			ret = snprintf(dst, room, spec, (int)a.i);
+			break;
+		case 'p':
+			spec[sl++] = c.conv;
+			spec[sl] = '\0';
+			ret = snprintf(dst, room, spec, integer ?
+				       (const void *)(uintptr_t)a.u : a.p);
+			break;
+		case 's':
+			/* Keep the length modifier (`%ls`): */
+			memcpy(&spec[sl], length, (size_t)(c.end - length));
+			spec[sl + (size_t)(c.end - length)] = '\0';
+			ret = snprintf(dst, room, spec,
+				       integer ? "(invalid)" : (const char *)a.p);
+			break;
+		default:
+			/* Floating-point conversions: */
+			spec[sl++] = 'L';
+			spec[sl++] = c.conv;
+			spec[sl] = '\0';
+			ret = snprintf(dst, room, spec, integer ?
+				       (long double)a.i : a.f);
+			break;
+		}
+
+		if (ret <= 0)
+			continue;
+
+		if (o->s)
+			o->len += (size_t)ret;
+		else
+			out_write(o, conv, ((size_t)ret < room) ? (size_t)ret :
+				  room-1);
+#endif
+	}
+
+	out_write(o, fm, strlen(fm));
+}
+
+/* Loads the argument `argi` stored at `*pos` of the entry and advances `*pos`
+ to the next one */
+static void arg_load(const struct logger_entry *e, int argi, size_t *pos,
+		     struct arg *a)
+{
+	const unsigned char *p = &e->args[*pos];
+
+	a->type = arg_type(e, argi);
+	a->i = 0;
+	a->u = 0;
+	a->f = 0;
+	a->p = NULL;
+
+	switch (a->type) {
+	case LOGGER_ARG_NONE:
+		break;
+	case LOGGER_ARG_INT: {
+		int val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->i = val;
+		a->u = (unsigned int)val;
+		break;
+	}
+	case LOGGER_ARG_UINT: {
+		unsigned int val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->i = val;
+		a->u = val;
+		break;
+	}
+	case LOGGER_ARG_LONG: {
+		long val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->i = val;
+		a->u = (unsigned long)val;
+		break;
+	}
+	case LOGGER_ARG_ULONG: {
+		unsigned long val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->i = (intmax_t)val;
+		a->u = val;
+		break;
+	}
+	case LOGGER_ARG_LLONG: {
+		long long val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->i = val;
+		a->u = (unsigned long long)val;
+		break;
+	}
+	case LOGGER_ARG_ULLONG: {
+		unsigned long long val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->i = (intmax_t)val;
+		a->u = val;
+		break;
+	}
+	case LOGGER_ARG_DOUBLE: {
+		double val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->f = val;
+		break;
+	}
+	case LOGGER_ARG_LDOUBLE: {
+		long double val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->f = val;
+		break;
+	}
+	case LOGGER_ARG_PTR: {
+		const void *val;
+		memcpy(&val, p, sizeof(val));
+		*pos += sizeof(val);
+		a->p = val;
+		break;
+	}
+	case LOGGER_ARG_STR:
+#if LOGGER_STRING_COPY
+		a->p = p;
+		*pos += strlen((const char *)p) + 1;
+#else
+		memcpy(&a->p, p, sizeof(a->p));
+		*pos += sizeof(a->p);
+#endif
+		break;
+	}
+}
+
+static enum logger_arg_type arg_type(const struct logger_entry *e, int argi)
+{
+	return (enum logger_arg_type)((e->types >> (4*argi)) & 0xf);
+}
+
+static bool arg_integer(const struct arg *a)
+{
+	return (a->type != LOGGER_ARG_DOUBLE && a->type != LOGGER_ARG_LDOUBLE &&
+		a->type != LOGGER_ARG_PTR && a->type != LOGGER_ARG_STR);
+}
+
+/* Converts an integer argument to the type given by the `hh` or `h` length
+ modifier of the conversion (`length` points to the modifier or to the
+ conversion character), as printf() does */
+static void arg_narrow(struct arg *a, const char *length)
+{
+	if (!arg_integer(a) || length[0] != 'h')
+		return;
+
+	if (length[1] == 'h') {
+		a->i = (signed char)a->i;
+		a->u = (unsigned char)a->u;
+	} else {
+		a->i = (short)a->i;
+		a->u = (unsigned short)a->u;
+	}
+}
+
+#if LOGGER_BUILTIN_FORMAT
+
+/*
+ * Formats a single conversion (see #LOGGER_BUILTIN_FORMAT) like snprintf()
+ * without using the C library.
+ */
+static void format_conv(struct out *o, const char *spec, const struct arg *a)
+{
+	bool integer = arg_integer(a);
+	bool left = false;
+	bool zero = false;
+	bool alt = false;
+	char sign = '\0';
+	size_t width = 0;
+	size_t prec = 0;
+	bool has_prec = false;
+	const char *p = spec + 1;
+
+	/* Flags, width and precision: */
+	for (;; p++) {
+		if (*p == '-')
+			left = true;
+		else if (*p == '0')
+			zero = true;
+		else if (*p == '#')
+			alt = true;
+		else if (*p == '+')
+			sign = '+';
+		else if (*p == ' ' && sign == '\0')
+			sign = ' ';
+		else if (*p != ' ')
+			break;
+	}
+
+	while (*p >= '0' && *p <= '9')
+		width = width*10 + (size_t)(*p++ - '0');
+
+	if (*p == '.') {
+		p++;
+		/* Negative precision (passed by '*') is ignored: */
+		has_prec = (*p != '-');
+		if (*p == '-')
+			p++;
+		while (*p >= '0' && *p <= '9')
+			prec = prec*10 + (size_t)(*p++ - '0');
+	}
+
+	while (*p != '\0' && strchr("hljztL", *p))
+		p++;
+
+	/* Digits are composed from the end of the buffer: */
+	char buf[3*sizeof(uintmax_t)];
+	const char *str = &buf[sizeof(buf)];
+	const char *prefix = "";
+	uintmax_t val = 0;
+	unsigned int base = 0;
+	size_t length = 0;
+
+	switch (*p) {
+	case 'd': case 'i': {
+		intmax_t v = integer ? a->i : (intmax_t)a->f;
+		val = (v < 0) ? -(uintmax_t)v : (uintmax_t)v;
+		if (v < 0)
+			sign = '-';
+		base = 10;
+		break;
+	}
+	case 'o': case 'u': case 'x': case 'X':
+		val = integer ? a->u : (uintmax_t)a->f;
+		base = (*p == 'o') ? 8 : (*p == 'u') ? 10 : 16;
+		if (alt && val != 0 && base == 16)
+			prefix = (*p == 'x') ? "0x" : "0X";
+		sign = '\0';
+		break;
+	case 'p':
+		val = integer ? a->u : (uintmax_t)(uintptr_t)a->p;
+		base = 16;
+		prefix = "0x";
+		sign = '\0';
+		break;
+	case 'c':
+		buf[0] = (char)a->i;
+		str = buf;
+		length = 1;
+		sign = '\0';
+		zero = false;
+		break;
+	case 's':
+		str = integer ? "(invalid)" : a->p ? (const char *)a->p :
+		      "(null)";
+		while (str[length] != '\0' && (!has_prec || length < prec))
+			length++;
+		sign = '\0';
+		zero = false;
+		break;
+	default:
+		/* Unsupported conversion: */
+		out_write(o, spec, strlen(spec));
+		return;
+	}
+
+	size_t zeros = 0;
+
+	if (base) {
+		const char *digits = (*p == 'X') ? "0123456789ABCDEF" :
+				     "0123456789abcdef";
+		char *d = &buf[sizeof(buf)];
+
+		while (val != 0) {
+			*--d = digits[val % base];
+			val /= base;
+		}
+
+		str = d;
+		length = (size_t)(&buf[sizeof(buf)] - d);
+
+		/* The default precision is 1 (zero is printed as "0"): */
+		if (has_prec)
+			zero = false;
+		else
+			prec = 1;
+
+		if (alt && base == 8 && prec <= length)
+			prec = length + 1;
+
+		if (prec > length)
+			zeros = prec - length;
+	}
+
+	size_t total = (sign ? 1 : 0) + strlen(prefix) + zeros + length;
+	size_t pad = (width > total) ? width - total : 0;
+
+	if (!left && !zero)
+		out_fill(o, ' ', pad);
+	if (sign)
+		out_fill(o, sign, 1);
+	out_write(o, prefix, strlen(prefix));
+	if (!left && zero)
+		out_fill(o, '0', pad);
+	out_fill(o, '0', zeros);
+	out_write(o, str, length);
+	if (left)
+		out_fill(o, ' ', pad);
+}
+
+/* Appends `count` characters `c` like out_write() */
+static void out_fill(struct out *o, char c, size_t count)
+{
+	if (!o->s) {
+		char chunk[16];
+		memset(chunk, c, sizeof(chunk));
+
+		for (size_t i = 0; i < count; i += sizeof(chunk))
+			out_write(o, chunk, (count - i < sizeof(chunk)) ?
+				  count - i : sizeof(chunk));
+		return;
+	}
+
+	if (o->len < o->n) {
+		size_t fill = o->n - o->len - 1;
+		if (fill > count)
+			fill = count;
+
+		memset(&o->s[o->len], c, fill);
+		o->s[o->len + fill] = '\0';
+	}
+
+	o->len += count;
+}
+
+#endif
+
+/* Appends data to the output: Passes it to the stream or to the string buffer
+ (which is truncated and null-terminated like by snprintf()) */
+static void out_write(struct out *o, const char *data, size_t length)
+{
+	if (!o->s) {
+		/* Short chunks are gathered, long ones passed without copying: */
+		if (o->chunk_len + length > STREAM_CHUNK_SIZE)
+			out_flush(o);
+
+		if (length >= STREAM_CHUNK_SIZE) {
+			o->write_cb(data, length);
+		} else {
+			memcpy(&o->chunk[o->chunk_len], data, length);
+			o->chunk_len += length;
+		}
+	} else if (o->len < o->n) {
+		size_t copy = o->n - o->len - 1;
+		if (copy > length)
+			copy = length;
+
+		memcpy(&o->s[o->len], data, copy);
+		o->s[o->len + copy] = '\0';
+	}
+
+	o->len += length;
+}
+
+/* Passes the gathered chunks of a stream to logger.write_cb */
+static void out_flush(struct out *o)
+{
+	if (o->chunk_len > 0) {
+		o->write_cb(o->chunk, o->chunk_len);
+		o->chunk_len = 0;
+	}
+}
+
+#endif
+
 /**@}*/
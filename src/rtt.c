@@ -0,0 +1,220 @@
+/*
+ * This file is part of MCU-Common.
+ *
+ * Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+ *
+ * MCU-Common is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCU-Common is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders of this library give
+ * you permission to link this library with independent modules to
+ * produce an executable, regardless of the license terms of these
+ * independent modules, and to copy and distribute the resulting
+ * executable under terms of your choice, provided that you also meet,
+ * for each linked independent module, the terms and conditions of the
+ * license of that module.  An independent module is a module which is
+ * not derived from or based on this library.  If you modify this
+ * library, you may extend this exception to your version of the
+ * library, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+
+/**
+ * @defgroup rtt_module RTT
+ *
+ * In-memory output channel compatible with SEGGER Real Time Transfer (RTT)
+ *
+ * The data are written to a ring buffer in the target's RAM which is read by
+ * the host through the debug interface while the target is running (e.g. by
+ * SEGGER J-Link tools or OpenOCD's `rtt` commands). This is much faster than
+ * a UART and the target never waits for a peripheral. The control block can
+ * also be read from a memory dump or from a shared memory region on the host
+ * by `tools/rtt_read.py`.
+ *
+ * The target only modifies the write offset and the host only modifies the
+ * read offset of a buffer, so no locking is needed between them. The data are
+ * published by storing the write offset with release semantics. However,
+ * rtt_write() must not be called concurrently for the same buffer (e.g. it
+ * should be only called from logger_process() when used as logger.write_cb).
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <mcu-common/rtt.h>
+
+/**@{*/
+
+static size_t buffer_writable(const struct rtt_buffer *b);
+static size_t buffer_write(struct rtt_buffer *b, const char *data,
+			   size_t length);
+
+/**
+ * Initializes RTT control block.
+ *
+ * All up buffers are disabled until configured by rtt_config_up() or
+ * RTT_CONFIG_UP().
+ *
+ * @param rtt Pointer to the #rtt_cb structure
+ *
+ * @return `true` if initialization succeeds, `false` otherwise
+ */
+bool rtt_init(struct rtt_cb *rtt)
+{
+	assert(rtt != NULL);
+
+	memset(rtt, 0, sizeof(*rtt));
+	rtt->max_up = RTT_MAX_UP_BUFFERS;
+	rtt->max_down = 0;
+
+	/* The identifier is written last (and composed at run time, so that
+	 the host does not find its copy in the initialized data) */
+	SYNC_FENCE_RELEASE();
+	strcpy(&rtt->id[7], "RTT");
+	strcpy(&rtt->id[0], "SEGGER");
+	rtt->id[6] = ' ';
+
+	return true;
+}
+
+/**
+ * Configures an up (target to host) buffer.
+ *
+ * @param rtt           Pointer to the #rtt_cb structure
+ * @param index         Index of the up buffer (0 to #RTT_MAX_UP_BUFFERS-1)
+ * @param[in] name      Name of the buffer (optional, may be `NULL`)
+ * @param buffer        Pointer to the buffer
+ * @param size          Size of the buffer in bytes (one byte is unused)
+ * @param mode          Behavior if the buffer is full (see #rtt_mode)
+ *
+ * @return `true` if the buffer has been configured, `false` otherwise
+ */
+bool rtt_config_up(struct rtt_cb *rtt, unsigned int index, const char *name,
+		   char *buffer, size_t size, enum rtt_mode mode)
+{
+	assert(rtt != NULL);
+	assert(buffer != NULL);
+	assert(size > 1);
+
+	if (index >= RTT_MAX_UP_BUFFERS)
+		return false;
+
+	struct rtt_buffer *b = &rtt->up[index];
+
+	b->name = name;
+	b->buffer = buffer;
+	b->size = (unsigned int)size;
+	SYNC_STORE_RELAXED(&b->wr_off, 0);
+	SYNC_STORE_RELAXED(&b->rd_off, 0);
+	b->flags = (unsigned int)mode;
+
+	return true;
+}
+
+/**
+ * Writes data to an up buffer.
+ *
+ * If the data do not fit the buffer, the behavior depends on the buffer's
+ * mode (see #rtt_mode).
+ *
+ * @param rtt           Pointer to the #rtt_cb structure
+ * @param index         Index of the up buffer
+ * @param[in] data      Pointer to the data to be written
+ * @param length        Number of bytes to be written
+ *
+ * @return Number of bytes written
+ */
+size_t rtt_write(struct rtt_cb *rtt, unsigned int index, const void *data,
+		 size_t length)
+{
+	assert(rtt != NULL);
+	assert(data != NULL);
+
+	if (index >= RTT_MAX_UP_BUFFERS || rtt->up[index].buffer == NULL)
+		return 0;
+
+	struct rtt_buffer *b = &rtt->up[index];
+	const char *src = data;
+	size_t n;
+
+	switch (b->flags) {
+	case RTT_MODE_BLOCK_IF_FULL:
+		n = 0;
+		while (n < length)
+			n += buffer_write(b, &src[n], length - n);
+		return n;
+	case RTT_MODE_NO_BLOCK_TRIM:
+		return buffer_write(b, src, length);
+	default:
+		if (buffer_writable(b) < length)
+			return 0;
+		return buffer_write(b, src, length);
+	}
+}
+
+/**
+ * Returns number of bytes which can be written to an up buffer.
+ *
+ * @param rtt           Pointer to the #rtt_cb structure
+ * @param index         Index of the up buffer
+ *
+ * @return Number of bytes which can be written
+ */
+size_t rtt_writable(const struct rtt_cb *rtt, unsigned int index)
+{
+	assert(rtt != NULL);
+
+	if (index >= RTT_MAX_UP_BUFFERS || rtt->up[index].buffer == NULL)
+		return 0;
+
+	return buffer_writable(&rtt->up[index]);
+}
+
+static size_t buffer_writable(const struct rtt_buffer *b)
+{
+	unsigned int wr = SYNC_LOAD_RELAXED(&b->wr_off);
+	unsigned int rd = SYNC_LOAD_ACQUIRE(&b->rd_off);
+
+	if (rd > wr)
+		return rd - wr - 1;
+	else
+		return b->size - (wr - rd) - 1;
+}
+
+static size_t buffer_write(struct rtt_buffer *b, const char *data,
+			   size_t length)
+{
+	size_t n = buffer_writable(b);
+	if (length < n)
+		n = length;
+
+	unsigned int wr = SYNC_LOAD_RELAXED(&b->wr_off);
+
+	/* Copy the data in (at most) two contiguous blocks: */
+	size_t n1 = b->size - wr;
+	if (n1 > n)
+		n1 = n;
+
+	memcpy(&b->buffer[wr], data, n1);
+	memcpy(b->buffer, &data[n1], n - n1);
+
+	wr += n;
+	if (wr >= b->size)
+		wr -= b->size;
+
+	SYNC_STORE_RELEASE(&b->wr_off, wr);
+
+	return n;
+}
+
+/**@}*/
@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+#
+# This file is part of MCU-Common.
+#
+# Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+#
+# MCU-Common is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# MCU-Common is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Decoder for binary logger frames (LOGGER_BINARY=1).
+
+Reads COBS-encoded frames produced by logger_process() from a file, a serial
+port or stdin, looks the format strings (and %s arguments) up in the
+firmware's ELF file and prints the formatted messages.
+
+Example:
+    logger_decode.py firmware.elf /dev/ttyUSB0
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+RECORD_ARGC_MASK = 0x1f
+RECORD_TIMESTAMP = 0x20
+RECORD_SEQ = 0x40
+RECORD_STRINGS = 0x80
+
+CONVERSION = re.compile(r'%([-+ #0]*)(\*|\d*)(?:\.(\*|\d*))?'
+                        r'(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcsp%])?')
+
+
+class Elf:
+    """Minimal ELF reader providing access to allocated sections."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+
+        if data[:4] != b'\x7fELF':
+            raise ValueError('{}: not an ELF file'.format(path))
+
+        self.is64 = data[4] == 2
+        self.endian = '<' if data[5] == 1 else '>'
+        self.ptr_size = 8 if self.is64 else 4
+        self.sections = []
+
+        if self.is64:
+            shoff, = struct.unpack_from(self.endian + 'Q', data, 0x28)
+            shentsize, shnum = struct.unpack_from(self.endian + 'HH', data,
+                                                  0x3a)
+            shdr = 'IIQQQQIIQQ'
+        else:
+            shoff, = struct.unpack_from(self.endian + 'I', data, 0x20)
+            shentsize, shnum = struct.unpack_from(self.endian + 'HH', data,
+                                                  0x2e)
+            shdr = 'IIIIIIIIII'
+
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset,
+             size) = struct.unpack_from(self.endian + shdr, data,
+                                        shoff + i*shentsize)[:6]
+            SHT_NOBITS, SHF_ALLOC = 8, 2
+            if sh_type != SHT_NOBITS and (flags & SHF_ALLOC) and size:
+                self.sections.append((addr, data[offset:offset+size]))
+
+    def string(self, addr):
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                end = data.find(b'\0', addr - base)
+                if end < 0:
+                    end = len(data)
+                return data[addr-base:end].decode('utf-8', 'replace')
+        return None
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            raise ValueError('invalid COBS frame')
+        out += data[i+1:i+code]
+        i += code
+        if code < 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+# Argument types (enum logger_arg_type)
+ARG_INT, ARG_UINT, ARG_LONG, ARG_ULONG, ARG_LLONG, ARG_ULLONG, ARG_DOUBLE, \
+    ARG_LDOUBLE, ARG_PTR, ARG_STR = range(1, 11)
+
+
+class Args:
+    """Reader of argument values stored with the sizes of the target types
+    and tagged by their types."""
+
+    def __init__(self, elf, data, types, strings):
+        self.elf = elf
+        self.data = data
+        self.types = types
+        self.pos = 0
+        self.strings = strings
+
+    def int(self, size, signed):
+        code = {1: 'b', 2: 'h', 4: 'i', 8: 'q'}[size]
+        if not signed:
+            code = code.upper()
+        val, = struct.unpack_from(self.elf.endian + code, self.data, self.pos)
+        self.pos += size
+        return val
+
+    def float(self, size):
+        if size != 8:
+            raise ValueError('unsupported long double size')
+        val, = struct.unpack_from(self.elf.endian + 'd', self.data, self.pos)
+        self.pos += size
+        return val
+
+    def string(self):
+        if self.strings:
+            end = self.data.index(b'\0', self.pos)
+            val = self.data[self.pos:end].decode('utf-8', 'replace')
+            self.pos = end + 1
+            return val
+        addr = self.int(self.elf.ptr_size, False)
+        if addr == 0:
+            return '(null)'
+        val = self.elf.string(addr)
+        return val if val is not None else '<0x{:x}>'.format(addr)
+
+    def next(self):
+        """Returns the type and the value of the next argument. Integers are
+        returned as a pair of the value and the value converted to the
+        unsigned type of its size."""
+        if not self.types:
+            raise ValueError('missing argument')
+        tag = self.types.pop(0)
+        ptr_size = self.elf.ptr_size
+
+        if ARG_INT <= tag <= ARG_ULLONG:
+            size = (4, ptr_size, 8)[(tag - ARG_INT) // 2]
+            val = self.int(size, (tag - ARG_INT) % 2 == 0)
+            return 'int', (val, val & ((1 << 8*size) - 1))
+        if tag == ARG_DOUBLE:
+            return 'float', self.float(8)
+        if tag == ARG_LDOUBLE:
+            return 'float', self.float(2*ptr_size)
+        if tag == ARG_PTR:
+            return 'ptr', self.int(ptr_size, False)
+        if tag == ARG_STR:
+            return 'str', self.string()
+        raise ValueError('unknown argument type {}'.format(tag))
+
+
+def render(elf, fmt, args):
+    """Formats the message, converts each argument from its stored type to the
+    type expected by the conversion, renders the conversions whose arguments
+    are missing as '?'."""
+    out = ''
+    pos = 0
+
+    def number(kind, val):
+        if kind == 'int':
+            return val[0]
+        if kind == 'float':
+            return int(val)
+        return 0
+
+    for match in CONVERSION.finditer(fmt):
+        out += fmt[pos:match.start()]
+        pos = match.end()
+        flags, width, prec, length, conv = match.groups()
+
+        if conv == '%':
+            out += '%'
+            continue
+        if conv is None:
+            out += match.group(0)
+            continue
+
+        try:
+            if width == '*':
+                width = str(number(*args.next()))
+            if prec == '*':
+                prec = str(number(*args.next()))
+            spec = '%' + flags + width + ('.' + prec if prec else '')
+            kind, val = args.next()
+
+            if conv in 'di':
+                out += (spec + 'd') % number(kind, val)
+            elif conv in 'ouxX':
+                out += (spec + conv) % (val[1] if kind == 'int' else
+                                        number(kind, val))
+            elif conv == 'c':
+                out += (spec + 'c') % chr(number(kind, val) & 0xff)
+            elif conv in 'eEfFgGaA':
+                val = float(val[0] if kind == 'int' else val)
+                if conv in 'aA':
+                    out += (spec + 's') % val.hex()
+                else:
+                    out += (spec + conv) % val
+            elif conv == 's':
+                out += (spec + 's') % (val if kind == 'str' else
+                                       elf.string(val) if kind == 'ptr' else
+                                       '(invalid)')
+            else:
+                if kind == 'int':
+                    val = val[1]
+                elif kind != 'ptr':
+                    val = 0
+                out += (spec + 's') % '0x{:x}'.format(val)
+        except (struct.error, ValueError, TypeError):
+            out += '?'
+
+    return out + fmt[pos:]
+
+
+def decode_frame(elf, frame, timestamp_fmt='[%10u] '):
+    payload = cobs_decode(frame)
+    ptr_size = elf.ptr_size
+    header, size = payload[0], payload[1]
+    ts_size = 4 if header & RECORD_TIMESTAMP else 0
+    seq_size = 4 if header & RECORD_SEQ else 0
+    argc = header & RECORD_ARGC_MASK
+    offset = 2 + ptr_size + ts_size + seq_size
+
+    types = []
+    for i in range(argc):
+        types.append((payload[offset + i//2] >> (4*(i % 2))) & 0xf)
+    offset += (argc + 1) // 2
+
+    if len(payload) != offset + size:
+        raise ValueError('invalid frame length')
+
+    ptr_fmt = elf.endian + ('Q' if ptr_size == 8 else 'I')
+    fmt_addr, = struct.unpack_from(ptr_fmt, payload, 2)
+    prefix = ''
+    if ts_size:
+        timestamp, = struct.unpack_from(elf.endian + 'I', payload,
+                                        2 + ptr_size)
+        prefix = timestamp_fmt % timestamp
+
+    fmt = elf.string(fmt_addr)
+    if fmt is None:
+        raise ValueError('unknown format string address 0x{:x}'.format(
+                         fmt_addr))
+
+    args = Args(elf, payload[offset:], types, header & RECORD_STRINGS)
+    return prefix + render(elf, fmt, args)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('elf', help='firmware ELF file')
+    parser.add_argument('input', nargs='?', default='-',
+                        help='input file or serial port (default: stdin)')
+    parser.add_argument('--timestamp-format', default='[%10u] ',
+                        help='printf format of the timestamp prefix, must '
+                        'match LOGGER_TIMESTAMP_FMT of the firmware '
+                        '(default: %(default)r)')
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+
+    if args.input == '-':
+        stream = sys.stdin.buffer
+    else:
+        stream = open(args.input, 'rb', buffering=0)
+
+    frame = bytearray()
+    while True:
+        data = stream.read(1)
+        if not data:
+            break
+        if data != b'\0':
+            frame += data
+            continue
+
+        if frame:
+            try:
+                sys.stdout.write(decode_frame(elf, bytes(frame),
+                                              args.timestamp_format))
+                sys.stdout.flush()
+            except (ValueError, IndexError, TypeError, struct.error) as e:
+                sys.stderr.write('Invalid frame: {}\n'.format(e))
+        frame = bytearray()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+#
+# This file is part of MCU-Common.
+#
+# Copyright (C) 2017 Adam Heinrich <adam@adamh.cz>
+#
+# MCU-Common is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# MCU-Common is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with MCU-Common.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Reader of RTT up buffers (see the rtt module) from memory.
+
+Finds the RTT control block ("SEGGER RTT") in a memory dump of the target's
+RAM (e.g. created by GDB's `dump binary memory`) or in a shared memory region
+(e.g. a file in /dev/shm mapped by a host program) and writes the contents of
+an up buffer to stdout. With --follow, the file is mapped and polled for new
+data and the read offset is written back, so a producer using
+RTT_MODE_BLOCK_IF_FULL can proceed.
+
+Pointers stored in the control block are translated to file offsets using the
+address the file starts at (--base).
+
+Examples:
+    rtt_read.py --base 0x20000000 ram.bin
+    rtt_read.py --base 0x7f0000000000 --ptr-size 8 --follow /dev/shm/rtt
+    rtt_read.py --base 0x20000000 ram.bin | logger_decode.py firmware.elf
+"""
+
+import argparse
+import mmap
+import struct
+import sys
+import time
+
+RTT_ID = b'SEGGER RTT\0'
+
+
+class RttBuffer:
+    """Up buffer descriptor located at `offset` in the memory `mem`."""
+
+    def __init__(self, mem, offset, base, ptr_size):
+        self.mem = mem
+        ptr = '<I' if ptr_size == 4 else '<Q'
+        self.buffer = struct.unpack_from(ptr, mem, offset + ptr_size)[0]
+        self.buffer -= base
+        # size, wr_off, rd_off and flags follow the two pointers:
+        self.size_offset = offset + 2*ptr_size
+        self.size = struct.unpack_from('<I', mem, self.size_offset)[0]
+
+        if self.buffer < 0 or self.buffer + self.size > len(mem):
+            raise ValueError('buffer at 0x{:x} is out of the memory '
+                             '(wrong --base?)'.format(self.buffer + base))
+
+    def offsets(self):
+        return struct.unpack_from('<II', self.mem, self.size_offset + 4)
+
+    def read(self):
+        """Returns data between the read and write offsets."""
+        wr, rd = self.offsets()
+        if wr >= rd:
+            return bytes(self.mem[self.buffer + rd:self.buffer + wr]), wr
+        return (bytes(self.mem[self.buffer + rd:self.buffer + self.size]) +
+                bytes(self.mem[self.buffer:self.buffer + wr])), wr
+
+    def consume(self, rd):
+        """Stores the read offset (makes room for the producer)."""
+        struct.pack_into('<I', self.mem, self.size_offset + 8, rd)
+
+
+def find_buffer(mem, base, ptr_size, channel):
+    offset = mem.find(RTT_ID)
+    if offset < 0:
+        raise ValueError('RTT control block not found')
+
+    max_up = struct.unpack_from('<i', mem, offset + 16)[0]
+    if channel >= max_up:
+        raise ValueError('up buffer {} does not exist (max {})'.format(
+                         channel, max_up))
+
+    # The buffers are aligned to the pointer size:
+    first = offset + 24
+    size = 2*ptr_size + 16
+    size = (size + ptr_size - 1) // ptr_size * ptr_size
+
+    return RttBuffer(mem, first + channel*size, base, ptr_size)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', help='memory dump or shared memory file')
+    parser.add_argument('--base', type=lambda x: int(x, 0), default=0,
+                        help='address of the first byte of the file')
+    parser.add_argument('--ptr-size', type=int, choices=(4, 8), default=4,
+                        help='pointer size of the target (default: 4)')
+    parser.add_argument('--channel', type=int, default=0,
+                        help='up buffer index (default: 0)')
+    parser.add_argument('--follow', action='store_true',
+                        help='keep reading new data from a live region')
+    args = parser.parse_args()
+
+    out = sys.stdout.buffer
+
+    with open(args.input, 'r+b' if args.follow else 'rb') as f:
+        if args.follow:
+            mem = mmap.mmap(f.fileno(), 0)
+        else:
+            mem = f.read()
+
+        try:
+            buf = find_buffer(mem, args.base, args.ptr_size, args.channel)
+        except (ValueError, struct.error) as e:
+            sys.stderr.write('{}\n'.format(e))
+            sys.exit(1)
+
+        while True:
+            data, wr = buf.read()
+            if data:
+                out.write(data)
+                out.flush()
+            if not args.follow:
+                break
+            if data:
+                buf.consume(wr)
+            else:
+                time.sleep(0.01)
+
+
+if __name__ == '__main__':
+    main()